@@ -1,171 +1,4867 @@
 #include <vector>
-#include <set>
-#include <map>
+#include <string>
+#include <array>
 #include <algorithm>
 #include <math.h>
 #include <numeric>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
+#include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <new>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
 
+// Every word is referred to by its index in the dictionary
+typedef uint16_t WordId;
+
+// Feedback for one guess, packed in base 3 with the first letter most significant
+// Ex: "10200" = 1*81 + 0*27 + 2*9 + 0*3 + 0*1 = 99
+typedef uint8_t Pattern;
+
+const int NUM_PATTERNS = 243;
+const Pattern ALL_GREEN = NUM_PATTERNS - 1;
+
+
+// Immutable, interned word table: text is only needed for I/O
+// Answers get the first ids, so ids [0, numAnswers) are exactly the words that could be the Wordle
+struct Dictionary
+{
+    size_t numAnswers = 0;
+    vector<WordId> guesses;             // allowed guesses, in the order of the guess list
+
+    unordered_map<string, WordId> ids;  // word -> id
+    vector<string> text;                // id -> word
+    vector<array<uint8_t, 5>> letters;  // id -> letters as 0..25
+    vector<uint32_t> masks;             // id -> bit i set if the word contains letter i
+
+    // Structure-of-arrays copy of "letters" for the constraint filter
+    // columns[i][id] = 1 << (letter i of id)
+    vector<uint32_t> columns[5];
+
+    // Bitsets over "guesses" (bit j = guesses[j]) for the hard mode filter
+    vector<uint64_t> guessesWith[5][26];     // letter at position i
+    vector<uint64_t> guessesContaining[26];  // letter anywhere
+
+    // matrix[guess * numAnswers + answer] = getResult(guess, answer), once buildMatrix has run
+    vector<Pattern> matrix;
+};
+
+
+#ifdef WORDLEBOT_COUNT_ALLOCS
+// Heap allocations made by the current thread, used by --check-allocs
+// Only built with -DWORDLEBOT_COUNT_ALLOCS, so every other build keeps the normal allocator
+thread_local size_t numAllocations = 0;
+
+// Kept out of line, or GCC sees free() on memory from new and warns
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    numAllocations++;
+
+    if (void *p = malloc(size ? size : 1))
+        return p;
+
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+#endif
+
+
+// Monotonic allocator for data that lives and dies together, like a strategy tree
+// Memory comes out of large blocks and is only given back all at once by release()
+class Arena
+{
+public:
+    Arena(size_t blockSize = 1 << 20) : blockSize(blockSize) {}
+    ~Arena() { release(); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // Room for "n" default-initialized T's, which must not need destructing
+    template <class T>
+    T *allocate(size_t n)
+    {
+        size_t size = n * sizeof(T);
+        size_t pad = (alignof(T) - uintptr_t(cur) % alignof(T)) % alignof(T);
+
+        if (pad + size > left)
+        {
+            // Oversized requests get a block of their own
+            size_t capacity = max(blockSize, size + alignof(T));
+            cur = (char *) malloc(capacity);
+
+            if (!cur)
+                throw bad_alloc();
+
+            blocks.push_back(cur);
+            left = capacity;
+            pad = (alignof(T) - uintptr_t(cur) % alignof(T)) % alignof(T);
+        }
+
+        T *result = (T *) (cur + pad);
+        cur += pad + size;
+        left -= pad + size;
+
+        return new (result) T[n];
+    }
+
+    // Frees every block at once
+    void release()
+    {
+        for (char *block : blocks)
+            free(block);
+
+        blocks.clear();
+        cur = nullptr;
+        left = 0;
+    }
+
+private:
+    size_t blockSize;
+    vector<char *> blocks;
+    char *cur = nullptr;
+    size_t left = 0;
+};
+
+
+// Fixed set of worker threads for running the same job over many indices
+// The calling thread works too, as worker 0
+class ThreadPool
+{
+public:
+    ThreadPool(int numThreads) : queues(new WorkQueue[numThreads])
+    {
+        for (int i = 1; i < numThreads; i++)
+            workers.emplace_back([this, i] { run(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+
+        wake.notify_all();
+
+        for (thread &worker : workers)
+            worker.join();
+    }
+
+    int size() const { return int(workers.size()) + 1; }
+
+    // Calls fn(worker, i) for every i in [0, n) and returns once all calls are done
+    // Each worker starts on one contiguous chunk of the range; a worker that runs dry
+    // steals the back half of someone else's chunk, so slow indices don't idle the rest
+    void parallelFor(size_t n, const function<void(int, size_t)> &fn)
+    {
+        {
+            lock_guard<mutex> lock(m);
+
+            for (int worker = 0; worker < size(); worker++)
+            {
+                queues[worker].begin = n * worker / size();
+                queues[worker].end = n * (worker + 1) / size();
+            }
+
+            job = &fn;
+            pending = workers.size();
+            generation++;
+        }
+
+        wake.notify_all();
+        work(0);
+
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [this] { return pending == 0; });
+        job = nullptr;
+    }
+
+private:
+    // Indices [begin, end) waiting to run: the owner takes from the front, thieves from the back
+    struct alignas(64) WorkQueue
+    {
+        mutex m;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    vector<thread> workers;
+    unique_ptr<WorkQueue[]> queues;
+    mutex m;
+    condition_variable wake, done;
+    const function<void(int, size_t)> *job = nullptr;
+    size_t pending = 0;
+    size_t generation = 0;
+    bool stopping = false;
+
+    // Next index from the worker's own queue, or false if it's empty
+    bool pop(int worker, size_t &i)
+    {
+        WorkQueue &queue = queues[worker];
+        lock_guard<mutex> lock(queue.m);
+
+        if (queue.begin == queue.end)
+            return false;
+
+        i = queue.begin++;
+        return true;
+    }
+
+    // Moves the back half of another worker's queue into this worker's queue
+    bool steal(int worker)
+    {
+        for (int offset = 1; offset < size(); offset++)
+        {
+            WorkQueue &victim = queues[(worker + offset) % size()];
+            size_t begin, end;
+
+            {
+                lock_guard<mutex> lock(victim.m);
+
+                if (victim.begin == victim.end)
+                    continue;
+
+                begin = victim.begin + (victim.end - victim.begin) / 2;
+                end = victim.end;
+                victim.end = begin;
+            }
+
+            lock_guard<mutex> lock(queues[worker].m);
+            queues[worker].begin = begin;
+            queues[worker].end = end;
+            return true;
+        }
+
+        return false;
+    }
+
+    void work(int worker)
+    {
+        size_t i;
+
+        while (true)
+        {
+            if (pop(worker, i))
+                (*job)(worker, i);
+
+            else if (!steal(worker))
+                return;
+        }
+    }
+
+    void run(int worker)
+    {
+        size_t seen = 0;
+        unique_lock<mutex> lock(m);
+
+        while (true)
+        {
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+
+            if (stopping)
+                return;
+
+            seen = generation;
+            lock.unlock();
+            work(worker);
+            lock.lock();
+
+            if (--pending == 0)
+                done.notify_one();
+        }
+    }
+};
+
+
+// Collects output in one large buffer and hands it to the OS in big writes
+// Unlike cout << endl, nothing is flushed per line
+class Writer
+{
+public:
+    Writer(FILE *file, size_t capacity = 1 << 20) : file(file), capacity(capacity)
+    {
+        buffer = (char *) malloc(capacity);
+
+        if (!buffer)
+            throw bad_alloc();
+    }
+
+    ~Writer()
+    {
+        flush();
+        free(buffer);
+    }
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    Writer &write(const char *data, size_t size)
+    {
+        if (used + size > capacity)
+        {
+            flush();
+
+            if (size > capacity)
+            {
+                fwrite(data, 1, size, file);
+                return *this;
+            }
+        }
+
+        memcpy(buffer + used, data, size);
+        used += size;
+        return *this;
+    }
+
+    Writer &format(const char *fmt, ...)
+    {
+        char text[256];
+        va_list args;
+        va_start(args, fmt);
+        int size = vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        return write(text, min(size_t(max(size, 0)), sizeof(text) - 1));
+    }
+
+    Writer &operator<<(const string &s) { return write(s.data(), s.size()); }
+    Writer &operator<<(const char *s) { return write(s, strlen(s)); }
+    Writer &operator<<(char c) { return write(&c, 1); }
+
+    Writer &operator<<(long long n)
+    {
+        char digits[24];
+        return write(digits, snprintf(digits, sizeof(digits), "%lld", n));
+    }
+
+    Writer &operator<<(int n) { return *this << (long long) n; }
+    Writer &operator<<(size_t n) { return *this << (long long) n; }
+
+    // Same as an ostream with precision(3)
+    Writer &operator<<(double x)
+    {
+        char digits[32];
+        return write(digits, snprintf(digits, sizeof(digits), "%.3g", x));
+    }
+
+    void flush()
+    {
+        fwrite(buffer, 1, used, file);
+        fflush(file);
+        used = 0;
+    }
+
+private:
+    FILE *file;
+    char *buffer;
+    size_t capacity;
+    size_t used = 0;
+};
+
+
 // Reads possible wordles from "filename"
+// Words are upper-cased, and lines that aren't 5 letters are skipped
 vector<string> loadWords(string filename)
 {
     string cur;
     vector<string> result;
     ifstream file(filename);
-    
+
     while (getline(file, cur))
     {
         transform(cur.begin(), cur.end(), cur.begin(), ::toupper);
-        result.push_back(cur);
+
+        if (cur.size() == 5 && all_of(cur.begin(), cur.end(), [](char c) { return c >= 'A' && c <= 'Z'; }))
+            result.push_back(cur);
     }
-    
+
     return result;
 }
 
 
-// 0 = Gray (wrong place, wrong char)
-// 1 = Yellow (wrong place, right char)
-// 2 = Green (right place, right char)
-string getResult(string &guess, string &word)
+// Returns the id of "word", interning it first if it's new
+WordId addWord(Dictionary &dict, const string &word)
 {
-    string result;
-    
+    auto it = dict.ids.find(word);
+
+    if (it != dict.ids.end())
+        return it->second;
+
+    WordId id = WordId(dict.text.size());
+    array<uint8_t, 5> letters;
+    uint32_t mask = 0;
+
     for (int i = 0; i < 5; i++)
     {
-        if (guess[i] == word[i])
-            result += '2';
-        
-        else if (word.find(guess[i]) != string::npos)
-            result += '1';
-        
-        else
-            result += '0';
+        letters[i] = word[i] - 'A';
+        mask |= 1u << letters[i];
+        dict.columns[i].push_back(1u << letters[i]);
     }
-    
-    return result;
+
+    dict.ids[word] = id;
+    dict.text.push_back(word);
+    dict.letters.push_back(letters);
+    dict.masks.push_back(mask);
+
+    return id;
 }
 
 
-// "words" = the entire, original word list
-// "copy" = a list of words that could be the Wordle
-string getGuess(vector<string> &words, vector<string> &copy)
+// "answers" = words that could be the Wordle
+// "guesses" = words the bot may guess (empty = the answers)
+Dictionary makeDictionary(const vector<string> &answers, const vector<string> &guesses)
 {
-    // Record the count of each response for every remaining possible answer
-    // Ex: "about" returns "10200" for 3 strings, "20000" for 4 strings, etc.
-    map<string, int> count;
+    Dictionary dict;
 
-    for (string guess : words)
-        for (string answer : copy)
-            count[guess + getResult(guess, answer)]++;
+    for (const string &word : answers)
+        addWord(dict, word);
 
-    string guess = words[0];
-    int minWords = pow(10, 9);
-    
-    // Used to check if a guess could be the Wordle
-    set<string> wordleSet(copy.begin(), copy.end());
+    dict.numAnswers = dict.text.size();
 
-    for (string curGuess : words)
+    if (guesses.empty())
     {
-        int curWords = 0;
+        for (size_t id = 0; id < dict.numAnswers; id++)
+            dict.guesses.push_back(WordId(id));
+    }
 
-        for (string answer : copy)
-            // How many answers will this guess not eliminate?
-            curWords += count[curGuess + getResult(curGuess, answer)];
+    else
+    {
+        vector<bool> seen(answers.size() + guesses.size());
 
-        // curWords == minWords... prioritizes guesses that could be the Wordle --> avoid infinite loop!
-        if (curWords < minWords || (curWords == minWords && wordleSet.find(curGuess) != wordleSet.end()))
+        for (const string &word : guesses)
         {
-            guess = curGuess;
-            minWords = curWords;
+            WordId id = addWord(dict, word);
+
+            if (!seen[id])
+                dict.guesses.push_back(id);
+
+            seen[id] = true;
         }
     }
 
-    return guess;
+    size_t numBlocks = (dict.guesses.size() + 63) / 64;
+
+    for (int c = 0; c < 26; c++)
+    {
+        dict.guessesContaining[c].assign(numBlocks, 0);
+
+        for (int i = 0; i < 5; i++)
+            dict.guessesWith[i][c].assign(numBlocks, 0);
+    }
+
+    for (size_t j = 0; j < dict.guesses.size(); j++)
+    {
+        const array<uint8_t, 5> &letters = dict.letters[dict.guesses[j]];
+        uint64_t bit = 1ull << (j % 64);
+
+        for (int i = 0; i < 5; i++)
+        {
+            dict.guessesWith[i][letters[i]][j / 64] |= bit;
+            dict.guessesContaining[letters[i]][j / 64] |= bit;
+        }
+    }
+
+    return dict;
 }
 
 
-// Returns the number of guesses used
-// "words" = original list of possible words
-// "word" = the current word we're trying to guess
-// "verbose" = should the algorithm print its process?
-// "firstGuess" = precomputed optimal first guess to save time
-int play(vector<string> &words, string word, bool verbose=false, string firstGuess="RAISE")
+// Returns the id of "word" or -1 if it isn't in the dictionary
+int findWord(const Dictionary &dict, string word)
 {
-    int numGuesses = 0;
-    string lastGuess = "";
-    
-    // List of possible answers
-    vector<string> copy = words;
-    
-    while (copy.size() > 1)
+    transform(word.begin(), word.end(), word.begin(), ::toupper);
+    auto it = dict.ids.find(word);
+    return it == dict.ids.end() ? -1 : it->second;
+}
+
+
+// FNV-1a, used to identify candidate sets and configurations and to check records on disk
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
     {
-        numGuesses++;
-        string guess = numGuesses == 1 ? firstGuess : getGuess(words, copy);
-        lastGuess = guess;
-        
-        if (verbose)
-            cout << "Guess #" << numGuesses << ": " << guess << endl;
-        
-        string result = getResult(guess, word);
-        
-        // New possible answers
-        vector<string> newCopy;
-        
-        for (string answer : copy)
-            if (result == getResult(guess, answer))
-                newCopy.push_back(answer);
-        
-        copy = newCopy;
-    }
-    
-    if (lastGuess != word)
+        hash ^= ((const uint8_t *) data)[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+// 0 = Gray (wrong place, wrong char)
+// 1 = Yellow (wrong place, right char)
+// 2 = Green (right place, right char)
+Pattern getResult(const Dictionary &dict, WordId guess, WordId word)
+{
+    const array<uint8_t, 5> &g = dict.letters[guess];
+    const array<uint8_t, 5> &w = dict.letters[word];
+    uint32_t mask = dict.masks[word];
+    int result = 0;
+
+    for (int i = 0; i < 5; i++)
     {
-        numGuesses++;
-        
-        if (verbose)
-            cout << "Guess #" << numGuesses << ": " << word << endl;
-    }
-    
-    if (verbose)
-        cout << "The word was: " << copy[0] << ". We found it in " << numGuesses << " guesses!" << endl;
-    
-    return numGuesses;
+        result *= 3;
+
+        if (g[i] == w[i])
+            result += 2;
+
+        else if (mask & (1u << g[i]))
+            result += 1;
+    }
+
+    return Pattern(result);
 }
 
 
-int main()
+// getResult's feedback for a guess with letters "guess" that got the game's feedback "result"
+// The game grays copies of a letter past the word's count, where getResult marks every copy yellow;
+// the two only differ when the guess repeats a letter
+Pattern looseResult(const array<uint8_t, 5> &guess, Pattern result)
 {
-    vector<string> words = loadWords("wordlewords.txt");
-    
-    if (words.size() == 0)
+    int digits[5];
+    uint32_t shown = 0;   // letters with a green or yellow copy
+
+    for (int i = 4; i >= 0; i--, result /= 3)
     {
-        cout << "Couldn't read file!" << endl;
-        return 0;
+        digits[i] = result % 3;
+        shown |= (digits[i] != 0) << guess[i];
+    }
+
+    int loose = 0;
+
+    for (int i = 0; i < 5; i++)
+        loose = loose * 3 + (digits[i] == 2 ? 2 : shown >> guess[i] & 1);
+
+    return Pattern(loose);
+}
+
+
+// Precomputes getResult for every word against every answer, so getGuess only does lookups
+void buildMatrix(Dictionary &dict)
+{
+    dict.matrix.resize(dict.text.size() * dict.numAnswers);
+
+    for (size_t guess = 0; guess < dict.text.size(); guess++)
+        for (size_t answer = 0; answer < dict.numAnswers; answer++)
+            dict.matrix[guess * dict.numAnswers + answer] = getResult(dict, WordId(guess), WordId(answer));
+}
+
+
+// getResult for any word against an answer, through the matrix if it's been built
+inline Pattern lookupResult(const Dictionary &dict, WordId guess, WordId answer)
+{
+    return dict.matrix.empty() ? getResult(dict, guess, answer) : dict.matrix[guess * dict.numAnswers + answer];
+}
+
+
+// Converts a packed pattern back to its "10200" form for printing
+string patternString(Pattern pattern)
+{
+    string result(5, '0');
+
+    for (int i = 4; i >= 0; i--)
+    {
+        result[i] = '0' + pattern % 3;
+        pattern /= 3;
+    }
+
+    return result;
+}
+
+
+// Reads feedback typed as "10200", or with b(lack), y(ellow) and g(reen) for 0, 1 and 2
+// Returns false if "text" isn't 5 such characters
+bool parsePattern(const string &text, Pattern &pattern)
+{
+    if (text.size() != 5)
+        return false;
+
+    int result = 0;
+
+    for (char c : text)
+    {
+        const char *digit = strchr("0b1y2g", tolower(c));
+
+        if (!c || !digit)
+            return false;
+
+        result = result * 3 + int(digit - "0b1y2g") / 2;
+    }
+
+    pattern = Pattern(result);
+    return true;
+}
+
+
+// Reads a word typed in any case as letters 0..25, whether or not it's in the dictionary
+// Returns false if "text" isn't 5 letters
+bool parseLetters(const string &text, array<uint8_t, 5> &letters)
+{
+    if (text.size() != 5)
+        return false;
+
+    for (int i = 0; i < 5; i++)
+    {
+        if (!isalpha((unsigned char) text[i]))
+            return false;
+
+        letters[i] = uint8_t(toupper(text[i]) - 'A');
+    }
+
+    return true;
+}
+
+
+// How feedback marks a letter the guess has more than once
+enum Rules
+{
+    ENGINE_RULES,   // getResult's: every copy is yellow (or green) if the word has the letter at all
+    WORDLE_RULES    // the game's: copies past the word's count are gray, so the feedback reveals counts
+};
+
+
+// Everything the feedback so far reveals about the Wordle
+// Per-position letter masks and the letters that must appear cover getResult's feedback;
+// the real game's feedback can also bound how many copies of a letter there are
+struct Knowledge
+{
+    uint32_t allowed[5];   // letters that can still be at each position
+    uint32_t required;     // letters the word must contain
+    uint32_t counted;      // letters with a count bound that "allowed" and "required" don't already cover
+    uint8_t atLeast[26];   // fewest copies of each letter the word can have
+    uint8_t atMost[26];    // most copies of each letter the word can have
+
+    Knowledge()
+    {
+        for (uint32_t &mask : allowed)
+            mask = (1u << 26) - 1;
+
+        required = 0;
+        counted = 0;
+        memset(atLeast, 0, sizeof(atLeast));
+        memset(atMost, 5, sizeof(atMost));
     }
-    
-    // # of Guesses
-    vector<int> results;
+};
+
+
+// Narrows "k" by the feedback "result" for a guess with letters "guess"
+// The guess doesn't have to be in the dictionary, so user-entered histories work too
+// Under WORDLE_RULES, a letter that's gray and also green or yellow has exactly that many copies
+void addFeedback(Knowledge &k, const array<uint8_t, 5> &guess, Pattern result, Rules rules = ENGINE_RULES)
+{
+    int digits[5];
+    int shown[26] = {};   // green or yellow copies of each letter
+    uint32_t gray = 0;    // letters with a gray copy
 
-    for (int i = 0; i < 2315; i++)
+    for (int i = 4; i >= 0; i--)
     {
-        cout << "Wordle " << i+1 << ": " << endl;
-        results.push_back(play(words, words[i], true));
-        cout << endl;
+        digits[i] = result % 3;
+        result /= 3;
+        shown[guess[i]] += digits[i] != 0;
+        gray |= (digits[i] == 0) << guess[i];
     }
 
-    int n = int(results.size());
-    int sum = accumulate(results.begin(), results.end(), 0);
+    for (int i = 0; i < 5; i++)
+    {
+        uint32_t bit = 1u << guess[i];
+
+        if (digits[i] == 2)
+        {
+            k.allowed[i] &= bit;
+            k.required |= bit;
+        }
+
+        else if (digits[i] == 1 || (rules == WORDLE_RULES && shown[guess[i]] != 0))
+        {
+            k.allowed[i] &= ~bit;
+            k.required |= bit;
+        }
+
+        else
+        {
+            for (uint32_t &mask : k.allowed)
+                mask &= ~bit;
+        }
+    }
+
+    // getResult's feedback says nothing about counts
+    if (rules == ENGINE_RULES)
+        return;
+
+    for (int i = 0; i < 5; i++)
+    {
+        int letter = guess[i];
+
+        if (shown[letter] == 0)
+            continue;
+
+        k.atLeast[letter] = max(k.atLeast[letter], uint8_t(shown[letter]));
+
+        if (gray & (1u << letter))
+            k.atMost[letter] = min(k.atMost[letter], uint8_t(shown[letter]));
+
+        if (k.atLeast[letter] > 1 || k.atMost[letter] < 5)
+            k.counted |= 1u << letter;
+    }
+}
+
+
+// Can no word at all, in the dictionary or not, agree with "k"? Then the feedback it came from contradicts itself
+bool contradictory(const Knowledge &k)
+{
+    uint32_t anywhere = 0;
+    int numLetters = 0;
+
+    for (uint32_t mask : k.allowed)
+    {
+        if (mask == 0)
+            return true;
+
+        anywhere |= mask;
+    }
+
+    for (int letter = 0; letter < 26; letter++)
+    {
+        if (k.atLeast[letter] > k.atMost[letter])
+            return true;
+
+        numLetters += max(int(k.atLeast[letter]), int(k.required >> letter & 1));
+    }
+
+    return (k.required & ~anywhere) != 0 || numLetters > 5;
+}
+
+
+// The hints hard mode makes every later guess use: greens stay put and yellows get used again
+struct Hints
+{
+    uint8_t green[5] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };   // letter fixed at each position, 0xFF if none
+    uint32_t required = 0;                                   // letters every guess must contain
+};
+
+
+// Adds the hints the feedback "result" for a guess with letters "guess" reveals
+void addHints(Hints &hints, const array<uint8_t, 5> &guess, Pattern result)
+{
+    for (int i = 4; i >= 0; i--, result /= 3)
+    {
+        if (result % 3 == 2)
+            hints.green[i] = guess[i];
+
+        if (result % 3 != 0)
+            hints.required |= 1u << guess[i];
+    }
+}
+
+
+// Does word "id" use every hint in "hints"?
+inline bool usesHints(const Dictionary &dict, const Hints &hints, WordId id)
+{
+    bool ok = (dict.masks[id] & hints.required) == hints.required;
+
+    for (int i = 0; i < 5; i++)
+        ok &= hints.green[i] == 0xFF || dict.letters[id][i] == hints.green[i];
+
+    return ok;
+}
+
+
+// Does word "id" agree with everything in "k"?
+inline bool matches(const Dictionary &dict, const Knowledge &k, size_t id)
+{
+    bool ok = (dict.masks[id] & k.required) == k.required;
+
+    for (int i = 0; i < 5; i++)
+        ok &= (dict.columns[i][id] & k.allowed[i]) != 0;
+
+    for (uint32_t letters = k.counted; letters; letters &= letters - 1)
+    {
+        int letter = __builtin_ctz(letters);
+        int copies = 0;
+
+        for (uint8_t c : dict.letters[id])
+            copies += c == letter;
+
+        ok &= copies >= k.atLeast[letter] && copies <= k.atMost[letter];
+    }
+
+    return ok;
+}
+
+
+// Cleared by --kernel scalar so the portable loops can be checked against the SIMD ones
+bool useSimd = true;
+
+
+// Replaces "out" with every id in [0, "n") that agrees with "k", in id order
+// Only touches the dictionary's letter columns, so no feedback needs to be recomputed
+void filterWords(const Dictionary &dict, const Knowledge &k, size_t n, vector<WordId> &out)
+{
+    out.clear();
+    size_t id = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i required = _mm_set1_epi32(k.required);
+    __m128i allowed[5];
+
+    for (int i = 0; i < 5; i++)
+        allowed[i] = _mm_set1_epi32(k.allowed[i]);
+
+    // 4 words at a time: a lane survives if it has every required letter,
+    // each of its letters is allowed at that position and every counted letter appears a number of times in bounds
+    for (; useSimd && id + 4 <= n; id += 4)
+    {
+        __m128i mask = _mm_loadu_si128((const __m128i *) &dict.masks[id]);
+        __m128i ok = _mm_cmpeq_epi32(_mm_and_si128(mask, required), required);
+        __m128i columns[5];
+
+        for (int i = 0; i < 5; i++)
+        {
+            columns[i] = _mm_loadu_si128((const __m128i *) &dict.columns[i][id]);
+            ok = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(columns[i], allowed[i]), zero), ok);
+        }
+
+        for (uint32_t letters = k.counted; letters; letters &= letters - 1)
+        {
+            int letter = __builtin_ctz(letters);
+            __m128i bit = _mm_set1_epi32(1 << letter), copies = zero;
+
+            // Each match is -1, so subtracting counts up
+            for (int i = 0; i < 5; i++)
+                copies = _mm_sub_epi32(copies, _mm_cmpeq_epi32(columns[i], bit));
+
+            ok = _mm_and_si128(ok, _mm_cmpgt_epi32(copies, _mm_set1_epi32(k.atLeast[letter] - 1)));
+            ok = _mm_and_si128(ok, _mm_cmplt_epi32(copies, _mm_set1_epi32(k.atMost[letter] + 1)));
+        }
+
+        int lanes = _mm_movemask_ps(_mm_castsi128_ps(ok));
+
+        for (; lanes; lanes &= lanes - 1)
+            out.push_back(WordId(id + __builtin_ctz(lanes)));
+    }
+#endif
+
+    for (; id < n; id++)
+        if (matches(dict, k, id))
+            out.push_back(WordId(id));
+}
+
+
+// How getGuess ranks guesses
+enum Policy
+{
+    EXPECTED,     // fewest answers left on average
+    PARTITIONS,   // most distinct feedbacks
+    MINIMAX       // fewest answers left in the worst case, then on average
+};
+
+
+// Everything that decides which guesses play makes
+struct Strategy
+{
+    Policy policy = EXPECTED;
+    WordId firstGuess = 0;   // precomputed optimal first guess to save time
+    bool optimal = false;    // trees use the exact optimum instead (play itself is unaffected)
+    bool hardMode = false;   // every guess after the first has to use the hints revealed so far
+};
+
+
+// Scratch space for one thread's games
+// Everything is sized for the whole dictionary up front, so play never touches the heap
+struct SolverContext
+{
+    vector<WordId> copy;       // words that could be the Wordle
+    vector<WordId> newCopy;    // words that survive the current guess
+    vector<char> wordleSet;    // wordleSet[id] = is id in "copy"?
+    vector<WordId> pool;       // guesses hard mode still allows
+    vector<uint64_t> poolBits; // the same, as a bitset over dict.guesses
+    vector<Pattern> feedback;  // each word in "copy"'s feedback to the guess getGuess is scoring
+    int count[NUM_PATTERNS] = {};
+
+    SolverContext(const Dictionary &dict)
+    {
+        copy.reserve(dict.text.size());
+        newCopy.reserve(dict.text.size());
+        wordleSet.assign(dict.text.size(), false);
+        pool.reserve(dict.guesses.size());
+        poolBits.reserve(dict.guessesContaining[0].size());
+        feedback.resize(dict.text.size());
+    }
+};
+
+
+// The guesses that use every hint in "hints", in guess list order, built by ANDing the dictionary's bitsets
+// Falls back to "copy" (the candidates, which always fit the hints) if no guess does
+const vector<WordId> &hardModeGuesses(const Dictionary &dict, SolverContext &ctx, const Hints &hints, const vector<WordId> &copy)
+{
+    vector<uint64_t> &bits = ctx.poolBits;
+    bool any = false;
+
+    auto narrow = [&](const vector<uint64_t> &mask)
+    {
+        if (!any)
+            bits.assign(mask.begin(), mask.end());
+
+        else
+            for (size_t i = 0; i < bits.size(); i++)
+                bits[i] &= mask[i];
+
+        any = true;
+    };
+
+    uint32_t placed = 0;
+
+    for (int i = 0; i < 5; i++)
+    {
+        if (hints.green[i] != 0xFF)
+        {
+            narrow(dict.guessesWith[i][hints.green[i]]);
+            placed |= 1u << hints.green[i];
+        }
+    }
+
+    // A green letter is already contained
+    for (uint32_t letters = hints.required & ~placed; letters; letters &= letters - 1)
+        narrow(dict.guessesContaining[__builtin_ctz(letters)]);
+
+    if (!any)
+        return dict.guesses;
+
+    ctx.pool.clear();
+
+    for (size_t i = 0; i < bits.size(); i++)
+        for (uint64_t block = bits[i]; block; block &= block - 1)
+            ctx.pool.push_back(dict.guesses[i * 64 + __builtin_ctzll(block)]);
+
+    return ctx.pool.empty() ? copy : ctx.pool;
+}
+
+
+// "words" = the entire, original word list
+// "copy" = a list of words that could be the Wordle
+WordId getGuess(const Dictionary &dict, SolverContext &ctx, Policy policy, const vector<WordId> &words, const vector<WordId> &copy)
+{
+    WordId guess = words[0];
+    int minWords = pow(10, 9);
+    int64_t minSquares = 0;   // MINIMAX's tie-break
+
+    // Used to check if a guess could be the Wordle
+    vector<char> &wordleSet = ctx.wordleSet;
+
+    for (WordId answer : copy)
+        wordleSet[answer] = true;
+
+    // Record the count of each response for every remaining possible answer
+    // Ex: "about" returns "10200" for 3 answers, "20000" for 4 answers, etc.
+    // Kept all zero between guesses; with few answers, only the buckets they fell in are cleared
+    int *count = ctx.count;
+    Pattern *feedback = ctx.feedback.data();
+
+    for (WordId curGuess : words)
+    {
+        // The scores are kept up as the answers are counted, so no guess has to look at all 243 buckets:
+        // the n-th answer in a bucket adds 2n - 1 to the sum of squares, and the first one adds a feedback
+        int64_t squares = 0;
+        int distinct = 0, largest = 0;
+
+        // MINIMAX drops a guess as soon as one of its buckets outgrows the best guess's largest
+        int cutoff = policy == MINIMAX ? minWords : INT_MAX;
+        size_t counted = 0;
+
+        for (; counted < copy.size() && largest <= cutoff; counted++)
+        {
+            WordId answer = copy[counted];
+            Pattern p = feedback[counted] = dict.matrix.empty() ? getResult(dict, curGuess, answer)
+                                                                : dict.matrix[curGuess * dict.numAnswers + answer];
+            int n = ++count[p];
+            squares += 2 * n - 1;
+            distinct += n == 1;
+            largest = max(largest, n);
+        }
+
+        if (counted > size_t(NUM_PATTERNS))
+            fill(count, count + NUM_PATTERNS, 0);
+
+        else
+            for (size_t i = 0; i < counted; i++)
+                count[feedback[i]] = 0;
+
+        if (largest > cutoff)
+            continue;
+
+        // How many answers will this guess not eliminate?
+        // Every answer in a bucket of size n leaves n answers, so the bucket adds n^2
+        int curWords = int(squares);
+        int64_t curSquares = 0;
+
+        // Fewer empty buckets = more distinct feedbacks
+        if (policy == PARTITIONS)
+            curWords = NUM_PATTERNS - distinct;
+
+        // Largest bucket, then the expected score among guesses that tie on it
+        else if (policy == MINIMAX)
+        {
+            curWords = largest;
+            curSquares = squares;
+        }
+
+        bool tie = curWords == minWords && curSquares == minSquares;
+
+        // tie... prioritizes guesses that could be the Wordle --> avoid infinite loop!
+        if (curWords < minWords || (curWords == minWords && curSquares < minSquares) || (tie && wordleSet[curGuess]))
+        {
+            guess = curGuess;
+            minWords = curWords;
+            minSquares = curSquares;
+        }
+    }
+
+    for (WordId answer : copy)
+        wordleSet[answer] = false;
+
+    return guess;
+}
+
+
+// One state of a game: the guess made there and where each feedback leads
+// A node with no children is a leaf whose guess is its only candidate
+struct TreeNode
+{
+    WordId guess;
+    uint16_t numChildren;
+    uint32_t numCandidates;
+    WordId *candidates;    // words that could be the Wordle in this state (not kept in tree files)
+    Pattern *patterns;     // patterns[i] = feedback leading to children[i], ascending
+    TreeNode *children;    // siblings are contiguous, so a node's children share cache lines
+};
+
+
+// Marks a tree node whose guess isn't in the current dictionary
+const WordId NO_WORD = 0xFFFF;
+
+
+// Tree files start with this, then every word's text, the nodes, and the pattern leading to each node
+struct TreeFileHeader
+{
+    char magic[8];
+    uint64_t fingerprint;   // hashStrategy of the strategy the tree was built with
+    uint32_t numWords;
+    uint32_t numNodes;
+    uint64_t totalGuesses;  // over every answer the tree was built for
+    uint32_t maxGuesses;
+    uint32_t reserved;
+};
+
+const char TREE_MAGIC[8] = { 'W', 'B', 'T', 'R', 'E', 'E', '0', '4' };
+
+
+// 5 letters per word, padded so the nodes after it stay aligned
+size_t wordTableSize(size_t numWords)
+{
+    return (5 * numWords + 3) & ~size_t(3);
+}
+
+
+// A tree file mapped into memory and read in place, so loading it costs nothing up front
+// Nodes are in breadth-first order: a node's children are contiguous and come after it,
+// and the patterns leading to them sit in a separate byte array that a lookup scans without touching the nodes
+class MappedTree
+{
+public:
+    struct Node
+    {
+        WordId guess;             // index into the file's word table
+        uint16_t numChildren;
+        uint32_t firstChild;
+        uint32_t numCandidates;
+        uint32_t totalGuesses;    // over every candidate, counting from this node
+    };
+
+    MappedTree() {}
+
+    ~MappedTree()
+    {
+        if (base)
+            munmap(base, size);
+    }
+
+    MappedTree(const MappedTree &) = delete;
+    MappedTree &operator=(const MappedTree &) = delete;
+
+    // Maps "path" and matches its words to "dict" by text
+    // Returns an error message, or "" on success
+    string open(const string &path, const Dictionary &dict)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+
+        if (fd < 0 || fstat(fd, &info) != 0)
+        {
+            if (fd >= 0)
+                close(fd);
+
+            return "Couldn't open " + path;
+        }
+
+        size = info.st_size;
+        base = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+
+        if (base == MAP_FAILED)
+        {
+            base = nullptr;
+            return path + " isn't a strategy tree";
+        }
+
+        return attach((const uint8_t *) base, size, path, dict);
+    }
+
+    // Reads a tree already in memory, like one encodeTree just made, and keeps it
+    // Returns an error message, or "" on success
+    string load(vector<uint8_t> bytes, const Dictionary &dict)
+    {
+        owned = move(bytes);
+        return attach(owned.data(), owned.size(), "The tree", dict);
+    }
+
+private:
+    // Points the tree at the file's contents in "data", which "name" says where they came from
+    string attach(const uint8_t *data, size_t length, const string &name, const Dictionary &dict)
+    {
+        const TreeFileHeader *header = (const TreeFileHeader *) data;
+
+        if (length < sizeof(*header) || memcmp(header->magic, TREE_MAGIC, sizeof(header->magic)) != 0 ||
+            header->numNodes == 0 ||
+            length != sizeof(*header) + wordTableSize(header->numWords) + size_t(header->numNodes) * (sizeof(Node) + 1))
+            return name + " isn't a strategy tree";
+
+        this->header = *header;
+        numWords = header->numWords;
+        numNodes = header->numNodes;
+        words = (const char *) (data + sizeof(*header));
+        nodes = (const Node *) (data + sizeof(*header) + wordTableSize(numWords));
+        patterns = (const Pattern *) (nodes + numNodes);
+
+        ids.resize(numWords);
+
+        for (size_t i = 0; i < numWords; i++)
+        {
+            int id = findWord(dict, string(words + 5 * i, 5));
+            ids[i] = id < 0 ? NO_WORD : WordId(id);
+        }
+
+        return "";
+    }
+
+public:
+    const Node &root() const { return nodes[0]; }
+
+    // The current dictionary's id for the node's guess, or NO_WORD if it has none
+    WordId guess(const Node &node) const { return node.guess < numWords ? ids[node.guess] : NO_WORD; }
+
+    // Do the node's children all come after it and inside the file?
+    // Every walk relies on it, so a damaged file can't send one in circles or out of the mapping
+    bool childrenInPlace(const Node &node) const
+    {
+        size_t first = node.firstChild, last = first + node.numChildren;
+        return node.numChildren == 0 || (first > size_t(&node - nodes) && last <= numNodes);
+    }
+
+    // The child of "node" for feedback "result", or nullptr if the tree doesn't go there
+    const Node *child(const Node &node, Pattern result) const
+    {
+        size_t first = node.firstChild, last = first + node.numChildren;
+
+        if (node.numChildren == 0 || !childrenInPlace(node))
+            return nullptr;
+
+        const Pattern *it = lower_bound(patterns + first, patterns + last, result);
+        return it != patterns + last && *it == result ? &nodes[it - patterns] : nullptr;
+    }
+
+    const Node &node(size_t i) const { return nodes[i]; }
+    size_t indexOf(const Node &node) const { return &node - nodes; }
+
+    // The feedback that leads to node "i" from its parent
+    Pattern patternTo(size_t i) const { return patterns[i]; }
+
+    // Word "i" of the file's word table; the first root().numCandidates are the answers it was built for
+    string word(size_t i) const { return i < numWords ? string(words + 5 * i, 5) : "?????"; }
+
+    // The node's guess as the file spells it, whether or not the current dictionary has it
+    string text(const Node &node) const { return word(node.guess); }
+
+    TreeFileHeader header = {};
+    size_t numNodes = 0;
+
+private:
+    void *base = nullptr;                // the mapping, if the tree came from a file
+    size_t size = 0;
+    vector<uint8_t> owned;               // the tree's bytes, if it came from load()
+    size_t numWords = 0;
+    const char *words = nullptr;
+    const Node *nodes = nullptr;
+    const Pattern *patterns = nullptr;   // patterns[i] = feedback leading to nodes[i]
+    vector<WordId> ids;                  // the current dictionary's id for each word in the file
+};
+
+
+// Fingerprint of everything that affects which guesses get made
+uint64_t hashStrategy(const Dictionary &dict, const Strategy &strategy)
+{
+    uint64_t hash = hashBytes(&dict.numAnswers, sizeof(dict.numAnswers));
+
+    for (const string &word : dict.text)
+        hash = hashBytes(word.data(), word.size(), hash);
+
+    hash = hashBytes(dict.guesses.data(), dict.guesses.size() * sizeof(WordId), hash);
+    hash = hashBytes(&strategy.policy, sizeof(strategy.policy), hash);
+
+    if (strategy.optimal)
+        hash = hashBytes(&strategy.optimal, sizeof(strategy.optimal), hash);
+
+    if (strategy.hardMode)
+        hash = hashBytes(&strategy.hardMode, sizeof(strategy.hardMode), hash);
+
+    return hashBytes(&strategy.firstGuess, sizeof(strategy.firstGuess), hash);
+}
+
+
+// Error message if the tree file at "path" was built with another strategy or word list than "strategy", otherwise ""
+string strategyMismatch(const MappedTree &tree, const Dictionary &dict, const Strategy &strategy, const string &path)
+{
+    if (tree.header.fingerprint == hashStrategy(dict, strategy))
+        return "";
+
+    return path + " was built with a different strategy (--policy, --hard, --optimal or --opener) or word list";
+}
+
+
+// Returns the number of guesses used
+// "word" = the current word we're trying to guess, one of the dictionary's answers
+// "guesses" = if given, every guess made is appended to it
+// "tree" = if given, a precomputed strategy to follow for as long as it covers the game
+int play(const Dictionary &dict, SolverContext &ctx, const Strategy &strategy, WordId word,
+         vector<WordId> *guesses=nullptr, const MappedTree *tree=nullptr)
+{
+    int numGuesses = 0;
+    int lastGuess = -1;
+
+    // What the feedback so far says about "word"
+    Knowledge k;
+    Hints hints;
+
+    // Inside the tree every guess is a lookup, and candidates never need filtering
+    for (const MappedTree::Node *node = tree ? &tree->root() : nullptr; node; )
+    {
+        WordId guess = tree->guess(*node);
+
+        // A leaf that isn't "word" means the tree was built for other answers,
+        // and in hard mode a guess that drops a hint means it was built for other rules
+        if (guess == NO_WORD || (node->numCandidates == 1 && guess != word) ||
+            (strategy.hardMode && !usesHints(dict, hints, guess)))
+            break;
+
+        numGuesses++;
+        lastGuess = guess;
+
+        if (guesses)
+            guesses->push_back(guess);
+
+        if (guess == word)
+            return numGuesses;
+
+        Pattern result = getResult(dict, guess, word);
+        addFeedback(k, dict.letters[guess], result);
+        addHints(hints, dict.letters[guess], result);
+        node = tree->child(*node, result);
+    }
+
+    // List of possible answers
+    vector<WordId> &copy = ctx.copy;
+    filterWords(dict, k, dict.numAnswers, copy);
+
+    while (copy.size() > 1)
+    {
+        numGuesses++;
+        WordId guess = strategy.firstGuess;
+
+        if (numGuesses > 1)
+        {
+            const vector<WordId> &words = strategy.hardMode ? hardModeGuesses(dict, ctx, hints, copy) : dict.guesses;
+            guess = getGuess(dict, ctx, strategy.policy, words, copy);
+        }
+
+        lastGuess = guess;
+
+        if (guesses)
+            guesses->push_back(guess);
+
+        Pattern result = getResult(dict, guess, word);
+
+        addFeedback(k, dict.letters[guess], result);
+        addHints(hints, dict.letters[guess], result);
+
+        // New possible answers
+        filterWords(dict, k, dict.numAnswers, ctx.newCopy);
+        copy.swap(ctx.newCopy);
+    }
+
+    if (lastGuess != word)
+    {
+        numGuesses++;
+
+        if (guesses)
+            guesses->push_back(word);
+    }
+
+    return numGuesses;
+}
+
+
+// One finished game of the sweep, kept so games can finish in any order
+struct GameResult
+{
+    WordId word;
+    int numGuesses;
+    vector<WordId> guesses;
+};
+
+
+// How main reports the sweep
+enum OutputMode
+{
+    VERBOSE,   // every game's process, then the statistics
+    QUIET,     // only the statistics
+    CSV,       // one "answer,guesses,count" row per game
+    JSONL      // one JSON object per game
+};
+
+
+// Prints the process of a game in the given mode
+void printGame(Writer &out, const Dictionary &dict, OutputMode mode, const GameResult &game)
+{
+    if (mode == VERBOSE)
+    {
+        // Wordles are numbered by their place in the answer list
+        out << "Wordle " << game.word+1 << ": \n";
+
+        for (size_t i = 0; i < game.guesses.size(); i++)
+            out << "Guess #" << i+1 << ": " << dict.text[game.guesses[i]] << '\n';
+
+        out << "The word was: " << dict.text[game.word] << ". We found it in " << game.numGuesses << " guesses!\n";
+        out << '\n';
+    }
+
+    else if (mode == CSV)
+    {
+        out << dict.text[game.word] << ',';
+
+        for (size_t i = 0; i < game.guesses.size(); i++)
+            out << (i ? " " : "") << dict.text[game.guesses[i]];
+
+        out << ',' << game.numGuesses << '\n';
+    }
+
+    else if (mode == JSONL)
+    {
+        out << "{\"answer\":\"" << dict.text[game.word] << "\",\"guesses\":[";
+
+        for (size_t i = 0; i < game.guesses.size(); i++)
+            out << (i ? ",\"" : "\"") << dict.text[game.guesses[i]] << '"';
+
+        out << "],\"count\":" << game.numGuesses << "}\n";
+    }
+}
+
+// Running summary of guess counts that never stores the games themselves
+// Stats only hold integer sums, so merging them in any order gives the same totals
+struct Stats
+{
+    static constexpr int MAX_COUNT = 32;   // longer games share the last histogram slot
+
+    uint64_t games = 0;
+    uint64_t sum = 0;
+    uint64_t sumSquares = 0;
+    int minGuesses = 0;
+    int maxGuesses = 0;
+    uint64_t histogram[MAX_COUNT + 1] = {};   // histogram[n] = games that took n guesses
+
+    // Games and guesses by the feedback to the first guess
+    uint64_t bucketGames[NUM_PATTERNS] = {};
+    uint64_t bucketSum[NUM_PATTERNS] = {};
+
+    void add(int numGuesses, Pattern firstResult)
+    {
+        minGuesses = games == 0 ? numGuesses : min(minGuesses, numGuesses);
+        maxGuesses = games == 0 ? numGuesses : max(maxGuesses, numGuesses);
+        games++;
+        sum += numGuesses;
+        sumSquares += uint64_t(numGuesses) * numGuesses;
+        histogram[min(numGuesses, MAX_COUNT)]++;
+        bucketGames[firstResult]++;
+        bucketSum[firstResult] += numGuesses;
+    }
+
+    void merge(const Stats &other)
+    {
+        if (other.games == 0)
+            return;
+
+        minGuesses = games == 0 ? other.minGuesses : min(minGuesses, other.minGuesses);
+        maxGuesses = games == 0 ? other.maxGuesses : max(maxGuesses, other.maxGuesses);
+        games += other.games;
+        sum += other.sum;
+        sumSquares += other.sumSquares;
+
+        for (int n = 0; n <= MAX_COUNT; n++)
+            histogram[n] += other.histogram[n];
+
+        for (int p = 0; p < NUM_PATTERNS; p++)
+        {
+            bucketGames[p] += other.bucketGames[p];
+            bucketSum[p] += other.bucketSum[p];
+        }
+    }
+
+    // Guess count of the game at rank floor(fraction * games) if the games were sorted
+    int percentile(double fraction) const
+    {
+        uint64_t rank = min(games - 1, uint64_t(fraction * games));
+        uint64_t seen = 0;
+
+        for (int n = 0; n < MAX_COUNT; n++)
+        {
+            seen += histogram[n];
+
+            if (seen > rank)
+                return n;
+        }
+
+        return maxGuesses;
+    }
+
+    // "maxAllowed" = games that took more guesses than this count as failures
+    // "opener" = if given, the first guess, and the games are also broken down by the feedback to it
+    void print(Writer &out, int maxAllowed, const string &opener = "") const
+    {
+        if (games == 0)
+        {
+            out << "No games were played\n";
+            return;
+        }
+
+        double mean = double(sum) / games;
+        double variance = max(0.0, double(sumSquares) / games - mean * mean);
+        uint64_t failures = 0;
+
+        for (int n = maxAllowed + 1; n <= MAX_COUNT; n++)
+            failures += histogram[n];
+
+        out << "Here are the results! \n";
+        out << "Minimum # of Guesses: " << minGuesses << '\n';
+        out << "Median # of Guesses: "  << percentile(0.5) << '\n';
+        out << "Maximum # of Guesses: " << maxGuesses << '\n';
+        out << "Average # of Guesses: " << double(sum / float(games)) << '\n';
+        out << "Standard Deviation: " << sqrt(variance) << '\n';
+        out << "90th / 99th Percentile: " << percentile(0.9) << " / " << percentile(0.99) << '\n';
+        out << "Failures (> " << maxAllowed << " Guesses): " << size_t(failures)
+            << " (" << 100.0 * failures / games << "%)\n";
+
+        out << "Guess Counts:\n";
+
+        for (int n = 0; n <= MAX_COUNT; n++)
+            if (histogram[n])
+                out << "  " << n << (n == MAX_COUNT ? "+" : "") << ": " << size_t(histogram[n]) << '\n';
+
+        if (opener.empty())
+            return;
+
+        out << "Average by Response to " << opener << ":\n";
+
+        for (int p = 0; p < NUM_PATTERNS; p++)
+            if (bucketGames[p])
+                out << "  " << patternString(Pattern(p)) << ": " << double(bucketSum[p]) / bucketGames[p]
+                    << " (" << size_t(bucketGames[p]) << " games)\n";
+    }
+};
+
+
+// Picks the guess for a state with more than one candidate (ascending ids) at the given depth,
+// where "hints" is what hard mode would hold the guess to
+typedef function<WordId(const WordId *candidates, uint32_t numCandidates, int depth, const Hints &hints)> GuessChooser;
+
+
+// Sets "node" up to make "guess" when "candidates" (ascending ids) could be the Wordle:
+// one child per feedback, each holding its share of the candidates but not yet filled in
+// The guess itself is solved here if it's a candidate, and gets no child
+void splitNode(const Dictionary &dict, Arena &arena, TreeNode &node, WordId *candidates, uint32_t numCandidates, WordId guess)
+{
+    node.guess = guess;
+    node.numCandidates = numCandidates;
+    node.candidates = candidates;
+    node.numChildren = 0;
+    node.patterns = nullptr;
+    node.children = nullptr;
+
+    // Group the candidates by feedback
+    uint32_t count[NUM_PATTERNS] = {};
+
+    for (uint32_t i = 0; i < numCandidates; i++)
+        count[getResult(dict, guess, candidates[i])]++;
+
+    uint32_t remaining = numCandidates - count[ALL_GREEN];
+    count[ALL_GREEN] = 0;
+
+    for (int p = 0; p < NUM_PATTERNS; p++)
+        node.numChildren += count[p] != 0;
+
+    if (node.numChildren == 0)
+        return;
+
+    node.patterns = arena.allocate<Pattern>(node.numChildren);
+    node.children = arena.allocate<TreeNode>(node.numChildren);
+
+    // Every child's candidates live in one array, in pattern order
+    WordId *childCandidates = arena.allocate<WordId>(remaining);
+    uint32_t offset[NUM_PATTERNS];
+    uint32_t total = 0;
+
+    for (int p = 0; p < NUM_PATTERNS; p++)
+    {
+        offset[p] = total;
+        total += count[p];
+    }
+
+    for (uint32_t i = 0; i < numCandidates; i++)
+    {
+        Pattern result = getResult(dict, guess, candidates[i]);
+
+        if (result != ALL_GREEN)
+            childCandidates[offset[result]++] = candidates[i];
+    }
+
+    for (int p = 0, child = 0; p < NUM_PATTERNS; p++)
+    {
+        if (count[p] == 0)
+            continue;
+
+        TreeNode &next = node.children[child++];
+        next = TreeNode();
+        next.candidates = childCandidates + offset[p] - count[p];
+        next.numCandidates = count[p];
+        node.patterns[child - 1] = Pattern(p);
+    }
+}
+
+
+// Fills in "node" for the state where "candidates" could be the Wordle, then its subtree
+// A single candidate is a leaf that guesses it
+void buildNode(const Dictionary &dict, Arena &arena, const GuessChooser &chooseGuess,
+               TreeNode &node, WordId *candidates, uint32_t numCandidates, int depth, const Hints &hints = Hints())
+{
+    WordId guess = numCandidates == 1 ? candidates[0] : chooseGuess(candidates, numCandidates, depth, hints);
+    splitNode(dict, arena, node, candidates, numCandidates, guess);
+
+    for (int i = 0; i < node.numChildren; i++)
+    {
+        TreeNode &child = node.children[i];
+        Hints childHints = hints;
+        addHints(childHints, dict.letters[guess], node.patterns[i]);
+        buildNode(dict, arena, chooseGuess, child, child.candidates, child.numCandidates, depth + 1, childHints);
+    }
+}
+
+
+// Lays "root" out as a tree file: every node in breadth-first order, so siblings are adjacent
+// and the nodes near the root, which every game visits, share the first few pages
+vector<uint8_t> encodeTree(const Dictionary &dict, const TreeNode &root, uint64_t fingerprint)
+{
+    vector<const TreeNode *> order(1, &root);
+    vector<uint32_t> depth(1, 0);
+    vector<MappedTree::Node> nodes;
+    vector<Pattern> patterns(1, 0);
+    TreeFileHeader header = {};
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const TreeNode &node = *order[i];
+        nodes.push_back({ node.guess, node.numChildren, uint32_t(order.size()), node.numCandidates, 0 });
+
+        // The answer whose game ends here
+        if (find(node.candidates, node.candidates + node.numCandidates, node.guess) != node.candidates + node.numCandidates)
+        {
+            header.totalGuesses += depth[i] + 1;
+            header.maxGuesses = max(header.maxGuesses, depth[i] + 1);
+        }
+
+        for (int j = 0; j < node.numChildren; j++)
+        {
+            order.push_back(&node.children[j]);
+            depth.push_back(depth[i] + 1);
+            patterns.push_back(node.patterns[j]);
+        }
+    }
+
+    memcpy(header.magic, TREE_MAGIC, sizeof(header.magic));
+    header.fingerprint = fingerprint;
+    header.numWords = uint32_t(dict.text.size());
+    header.numNodes = uint32_t(nodes.size());
+
+    // Children come after their parents, so one backward pass adds up every subtree
+    for (size_t i = nodes.size(); i-- > 0; )
+    {
+        nodes[i].totalGuesses = nodes[i].numCandidates;
+
+        for (uint32_t j = nodes[i].firstChild; j < nodes[i].firstChild + nodes[i].numChildren; j++)
+            nodes[i].totalGuesses += nodes[j].totalGuesses;
+    }
+
+    string words;
+
+    for (const string &word : dict.text)
+        words += word;
+
+    words.resize(wordTableSize(header.numWords));
+
+    size_t nodesSize = nodes.size() * sizeof(nodes[0]);
+    vector<uint8_t> bytes(sizeof(header) + words.size() + nodesSize + patterns.size());
+    uint8_t *out = bytes.data();
+
+    memcpy(out, &header, sizeof(header));
+    memcpy(out += sizeof(header), words.data(), words.size());
+    memcpy(out += words.size(), nodes.data(), nodesSize);
+    memcpy(out += nodesSize, patterns.data(), patterns.size());
+    return bytes;
+}
+
+
+// Writes "root" as a tree file
+// Returns an error message, or "" on success
+string saveTree(const string &path, const Dictionary &dict, const TreeNode &root, uint64_t fingerprint)
+{
+    vector<uint8_t> bytes = encodeTree(dict, root, fingerprint);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    bool ok = file && fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+
+    if (file)
+        ok = fclose(file) == 0 && ok;
+
+    return ok ? "" : "Couldn't write " + path;
+}
+
+
+// Append-only file of finished work, so a run that gets killed can resume without redoing it
+// Records are buffered and written out at most every "interval" seconds, each write followed by fsync
+// The header holds a fingerprint of the run's configuration, so a stale file is never resumed
+class Checkpoint
+{
+public:
+    enum RecordType : uint8_t
+    {
+        GAME = 1,   // word, # of guesses, guesses
+        OPENER = 2, // an OpenerScore
+        STATE = 3   // a SavedState of the exact search
+    };
+
+    Checkpoint(double interval = 30) : interval(interval) {}
+
+    ~Checkpoint()
+    {
+        if (file)
+        {
+            flush();
+            fclose(file);
+        }
+    }
+
+    Checkpoint(const Checkpoint &) = delete;
+    Checkpoint &operator=(const Checkpoint &) = delete;
+
+    // Opens "path" for a run with the given fingerprint
+    // With "resume", every intact record already there is passed to onRecord; otherwise the file starts over
+    // Returns an error message, or "" on success
+    string open(const string &path, uint64_t fingerprint, bool resume,
+                const function<void(uint8_t type, const uint8_t *data, uint32_t size)> &onRecord)
+    {
+        file = fopen(path.c_str(), resume ? "r+b" : "w+b");
+
+        if (!file && resume)
+            file = fopen(path.c_str(), "w+b");
+
+        if (!file)
+            return "Couldn't open " + path;
+
+        Header header;
+        size_t good = 0;
+
+        if (fread(&header, sizeof(header), 1, file) == 1)
+        {
+            if (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.fingerprint != fingerprint)
+                return path + " was written for a different configuration";
+
+            good = sizeof(header);
+            vector<uint8_t> data;
+
+            // Read up to the first torn or corrupt record; anything after it is dropped
+            while (true)
+            {
+                RecordHeader record;
+
+                if (fread(&record, sizeof(record), 1, file) != 1)
+                    break;
+
+                data.resize(record.size);
+
+                if (fread(data.data(), 1, record.size, file) != record.size ||
+                    uint32_t(hashBytes(data.data(), record.size)) != record.check)
+                    break;
+
+                onRecord(record.type, data.data(), record.size);
+                good += sizeof(record) + record.size;
+            }
+        }
+
+        if (good == 0)
+        {
+            memcpy(header.magic, MAGIC, sizeof(header.magic));
+            header.fingerprint = fingerprint;
+            rewind(file);
+            fwrite(&header, sizeof(header), 1, file);
+            good = sizeof(header);
+        }
+
+        fflush(file);
+
+        if (ftruncate(fileno(file), good) != 0 || fseek(file, good, SEEK_SET) != 0)
+            return "Couldn't write " + path;
+
+        lastFlush = chrono::steady_clock::now();
+        return "";
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Thread-safe; written out once "interval" seconds have passed since the last write
+    void append(RecordType type, const vector<uint8_t> &data)
+    {
+        RecordHeader record = { type, uint32_t(data.size()), uint32_t(hashBytes(data.data(), data.size())) };
+        lock_guard<mutex> lock(m);
+
+        pending.insert(pending.end(), (const uint8_t *) &record, (const uint8_t *) (&record + 1));
+        pending.insert(pending.end(), data.begin(), data.end());
+
+        if (chrono::duration<double>(chrono::steady_clock::now() - lastFlush).count() >= interval)
+            write();
+    }
+
+    void flush()
+    {
+        lock_guard<mutex> lock(m);
+        write();
+    }
+
+private:
+    static constexpr char MAGIC[8] = { 'W', 'B', 'C', 'K', 'P', 'T', '0', '1' };
+
+    struct Header
+    {
+        char magic[8];
+        uint64_t fingerprint;
+    };
+
+#pragma pack(push, 1)
+    struct RecordHeader
+    {
+        uint8_t type;
+        uint32_t size;
+        uint32_t check;   // low bits of hashBytes(payload)
+    };
+#pragma pack(pop)
+
+    FILE *file = nullptr;
+    double interval;
+    mutex m;
+    vector<uint8_t> pending;
+    chrono::steady_clock::time_point lastFlush;
+
+    void write()
+    {
+        if (file && !pending.empty())
+        {
+            fwrite(pending.data(), 1, pending.size(), file);
+            fflush(file);
+            fsync(fileno(file));
+            pending.clear();
+        }
+
+        lastFlush = chrono::steady_clock::now();
+    }
+};
+
+
+// Identifies a set of candidates by two independent hashes of its ids
+struct SetKey
+{
+    uint64_t a, b;
+    uint32_t size;
+
+    bool operator==(const SetKey &other) const { return a == other.a && b == other.b && size == other.size; }
+};
+
+struct SetKeyHash
+{
+    size_t operator()(const SetKey &key) const { return size_t(key.a); }
+};
+
+// "salt" tells apart states with the same candidates that are solved under different rules
+SetKey makeKey(const WordId *candidates, uint32_t size, uint64_t salt = 0)
+{
+    uint64_t a = hashBytes(candidates, size * sizeof(WordId));
+    uint64_t b = hashBytes(candidates, size * sizeof(WordId), 0x9e3779b97f4a7c15ull);
+    return { a ^ salt * 0xff51afd7ed558ccdull, b ^ salt, size };
+}
+
+
+// What it takes to finish every game from one state
+struct Solved
+{
+    uint32_t total;        // guesses over all of the state's candidates, counting from this state
+    uint32_t maxGuesses;   // longest of those games
+
+    // A state solves the same way wherever it's reached, so the first result stands
+    bool improves(const Solved &) const { return false; }
+};
+
+
+// Thread-safe cache of solved states, shared by everything that explores the strategy
+// getGuess only depends on the candidates, so a state solves the same way wherever it's reached
+// "Value" says whether a new result should replace the one already stored with improves()
+// With a "capacity", a full table drops an arbitrary state for each new one, so it's a cache rather than a record
+template <class Value>
+class Memo
+{
+public:
+    explicit Memo(size_t capacity = 0) : shardCapacity((capacity + NUM_SHARDS - 1) / NUM_SHARDS) {}
+
+    bool find(const SetKey &key, Value &result)
+    {
+        Shard &shard = shards[key.b % NUM_SHARDS];
+        lock_guard<mutex> lock(shard.m);
+        auto it = shard.map.find(key);
+
+        if (it == shard.map.end())
+            return false;
+
+        result = it->second;
+        return true;
+    }
+
+    void insert(const SetKey &key, const Value &result)
+    {
+        Shard &shard = shards[key.b % NUM_SHARDS];
+        lock_guard<mutex> lock(shard.m);
+
+        if (shardCapacity > 0 && shard.map.size() >= shardCapacity && shard.map.find(key) == shard.map.end())
+            shard.map.erase(shard.map.begin());
+
+        auto added = shard.map.emplace(key, result);
+
+        if (!added.second && result.improves(added.first->second))
+            added.first->second = result;
+    }
+
+    size_t size()
+    {
+        size_t total = 0;
+
+        for (Shard &shard : shards)
+        {
+            lock_guard<mutex> lock(shard.m);
+            total += shard.map.size();
+        }
+
+        return total;
+    }
+
+private:
+    static const int NUM_SHARDS = 64;
+
+    struct Shard
+    {
+        mutex m;
+        unordered_map<SetKey, Value, SetKeyHash> map;
+    };
+
+    Shard shards[NUM_SHARDS];
+    size_t shardCapacity;   // 0 = unbounded
+};
+
+
+// Groups the candidates in scratch[begin, begin + size) by their feedback to "guess", in pattern order,
+// into scratch[top, top + the return value); the guess itself is solved and left out
+// "count" = set to the size of each group, with count[ALL_GREEN] = 0
+uint32_t partitionState(const Dictionary &dict, WordId guess, vector<WordId> &scratch,
+                        size_t begin, uint32_t size, size_t top, uint32_t count[NUM_PATTERNS])
+{
+    fill(count, count + NUM_PATTERNS, 0);
+
+    for (size_t i = begin; i < begin + size; i++)
+        count[lookupResult(dict, guess, scratch[i])]++;
+
+    uint32_t remaining = size - count[ALL_GREEN];
+    count[ALL_GREEN] = 0;
+
+    if (scratch.size() < top + remaining)
+        scratch.resize(max(top + remaining, 2 * scratch.size()));
+
+    uint32_t offset[NUM_PATTERNS];
+    uint32_t total = 0;
+
+    for (int p = 0; p < NUM_PATTERNS; p++)
+    {
+        offset[p] = total;
+        total += count[p];
+    }
+
+    for (size_t i = begin; i < begin + size; i++)
+    {
+        Pattern feedback = lookupResult(dict, guess, scratch[i]);
+
+        if (feedback != ALL_GREEN)
+            scratch[top + offset[feedback]++] = scratch[i];
+    }
+
+    return remaining;
+}
+
+
+// Solves the state whose candidates (ascending ids) are scratch[begin, begin + size) the way play would
+// "top" = where the free part of "scratch" starts; children are partitioned into it
+// "guess" = guess to make here instead of asking getGuess (which also skips the memo)
+Solved solveState(const Dictionary &dict, SolverContext &ctx, Policy policy, Memo<Solved> &memo,
+                  vector<WordId> &scratch, size_t begin, uint32_t size, size_t top, int guess = -1)
+{
+    if (size == 1)
+        return { 1, 1 };
+
+    bool useMemo = guess < 0;
+    SetKey key;
+    Solved result;
+
+    if (useMemo)
+    {
+        key = makeKey(&scratch[begin], size);
+
+        if (memo.find(key, result))
+            return result;
+
+        ctx.copy.assign(scratch.begin() + begin, scratch.begin() + begin + size);
+        guess = getGuess(dict, ctx, policy, dict.guesses, ctx.copy);
+    }
+
+    uint32_t count[NUM_PATTERNS];
+    uint32_t remaining = partitionState(dict, WordId(guess), scratch, begin, size, top, count);
+    size_t childBegin = top;
+    result = { size, 1 };
+
+    for (int p = 0; p < NUM_PATTERNS; p++)
+    {
+        if (count[p] == 0)
+            continue;
+
+        Solved child = solveState(dict, ctx, policy, memo, scratch, childBegin, count[p], top + remaining);
+        result.total += child.total;
+        result.maxGuesses = max(result.maxGuesses, child.maxGuesses + 1);
+        childBegin += count[p];
+    }
+
+    if (useMemo)
+        memo.insert(key, result);
+
+    return result;
+}
+
+
+// Fills in the game of every answer under "node" from the tree instead of replaying it
+// "path" = guesses made on the way to "node"
+// "gameOf" = index into "games" for each word id, or -1 to skip that answer
+void readGames(const TreeNode &node, vector<WordId> &path, const vector<int> &gameOf, vector<GameResult> &games)
+{
+    path.push_back(node.guess);
+
+    // The guess itself is the answer in this state if it's one of the candidates
+    bool solved = find(node.candidates, node.candidates + node.numCandidates, node.guess) != node.candidates + node.numCandidates;
+
+    if (solved && gameOf[node.guess] >= 0)
+    {
+        GameResult &game = games[gameOf[node.guess]];
+        game.word = node.guess;
+        game.numGuesses = int(path.size());
+        game.guesses = path;
+    }
+
+    for (int i = 0; i < node.numChildren; i++)
+        readGames(node.children[i], path, gameOf, games);
+
+    path.pop_back();
+}
+
+
+// Fewest total guesses any strategy could need for "n" candidates, counting from the current state:
+// at best one guess is right and splits the rest into singletons, which take one more guess each
+// Past 243 candidates some have to share a feedback, and those take at least one more
+uint32_t lowerBound(uint32_t n)
+{
+    return n <= NUM_PATTERNS ? 2 * n - 1 : 3 * n - (NUM_PATTERNS + 1);
+}
+
+
+// Most candidates any strategy could finish within "guesses" guesses:
+// one guess is right, and every other feedback leaves no more than one fewer guess can finish
+uint32_t capacity(int guesses)
+{
+    uint64_t n = 0;
+
+    for (int i = 0; i < guesses && n < UINT32_MAX; i++)
+        n = 1 + (NUM_PATTERNS - 1) * n;
+
+    return uint32_t(min(n, uint64_t(UINT32_MAX)));
+}
+
+
+// The cost of a state that can't be finished within the search's cap on guesses
+// Far above any real total, and still far from overflowing when a few are added up
+const uint32_t INFEASIBLE = UINT32_MAX / 4;
+
+
+// What the exact search knows about a state: its optimum, or a bound it's been proven not to beat
+struct Bound
+{
+    uint32_t total;   // fewest total guesses if "exact", otherwise a lower bound on them
+    WordId guess;     // the guess that achieves "total" if "exact"
+    bool exact;
+
+    // Proven bounds only go up, and an optimum is never replaced
+    bool improves(const Bound &old) const { return !old.exact && (exact || total > old.total); }
+};
+
+
+// A Bound as a checkpoint record, so a killed search can start again from everything it had proven
+#pragma pack(push, 1)
+struct SavedState
+{
+    uint64_t a, b;   // the state's SetKey
+    uint32_t size;
+    uint32_t total;
+    WordId guess;
+    uint8_t exact;
+};
+#pragma pack(pop)
+
+// Smaller states take less time to solve again than their records take to read, so they aren't saved
+const uint32_t MIN_SAVED = 16;
+
+
+// A guess worth trying in some state
+struct RankedGuess
+{
+    uint32_t bound;   // fewest total guesses the state could need after this guess
+    uint32_t score;   // the expected policy's score, to try the likeliest guesses first among equal bounds
+    WordId guess;
+
+    bool operator<(const RankedGuess &other) const
+    {
+        return bound != other.bound ? bound < other.bound : score != other.score ? score < other.score : guess < other.guess;
+    }
+};
+
+
+// Scratch space for one thread of the exact search
+struct SearchContext
+{
+    vector<WordId> scratch;                // candidate sets, each state's children partitioned above it
+    vector<vector<RankedGuess>> ranked;    // ranked[depth] = the guesses of the state being solved at that depth
+    vector<Pattern> feedback;              // each candidate's feedback to the guess being ranked
+    vector<WordId> pool;                   // the guesses being ranked
+    vector<char> guessable;                // guessable[id] = is id one of dict.guesses?
+    uint32_t count[NUM_PATTERNS] = {};     // kept all zero between uses
+    int maxGuesses = 0;                    // every game has to finish within this many guesses, 0 for no cap
+    Checkpoint *checkpoint = nullptr;      // where states of at least MIN_SAVED candidates are saved, if anywhere
+
+    SearchContext(const Dictionary &dict) : scratch(dict.numAnswers), feedback(dict.numAnswers),
+                                            guessable(dict.text.size())
+    {
+        iota(scratch.begin(), scratch.end(), 0);
+
+        for (WordId guess : dict.guesses)
+            guessable[guess] = true;
+    }
+};
+
+
+// Guesses left for a state "depth" guesses into the game, counting the one about to be made
+int guessesLeft(const SearchContext &ctx, int depth)
+{
+    return ctx.maxGuesses ? ctx.maxGuesses - depth : INT_MAX;
+}
+
+
+// Records what the search found for the state "key" in "memo", and in the checkpoint if it's worth saving
+void remember(SearchContext &ctx, Memo<Bound> &memo, const SetKey &key, const Bound &bound)
+{
+    memo.insert(key, bound);
+
+    if (ctx.checkpoint && key.size >= MIN_SAVED)
+    {
+        SavedState saved = { key.a, key.b, key.size, bound.total, bound.guess, bound.exact };
+        const uint8_t *bytes = (const uint8_t *) &saved;
+        ctx.checkpoint->append(Checkpoint::STATE, vector<uint8_t>(bytes, bytes + sizeof(saved)));
+    }
+}
+
+
+// Memo key for the candidates of a state "depth" guesses into the game
+// Without a cap, a state costs the same at any depth, so only a capped search tells depths apart
+SetKey stateKey(const SearchContext &ctx, const WordId *candidates, uint32_t size, int depth)
+{
+    return makeKey(candidates, size, ctx.maxGuesses ? uint64_t(guessesLeft(ctx, depth)) : 0);
+}
+
+
+// Fills "ranked" with every guess that splits scratch[begin, begin + size) and might finish it in under
+// "limit" guesses, most promising first
+// "depth" = guesses made before this state; with a cap, guesses leaving a feedback too big to finish
+// in time are dropped as soon as their largest bucket shows it
+// Returns the lowest bound of the guesses left out, or INFEASIBLE if there were none
+uint32_t rankGuesses(const Dictionary &dict, SearchContext &ctx, size_t begin, uint32_t size, uint32_t limit,
+                     int depth, vector<RankedGuess> &ranked)
+{
+    uint32_t lowest = INFEASIBLE;
+    uint32_t largest = capacity(guessesLeft(ctx, depth) - 1);
+    ranked.clear();
+
+    // A guess that isn't a candidate leaves every candidate needing another guess, and gives at most
+    // min(size, 242) feedbacks; when that alone reaches "limit", only the candidates are worth ranking
+    const vector<WordId> *pool = &dict.guesses;
+    uint32_t outsiderBound = 3 * size - min(size, uint32_t(NUM_PATTERNS - 1));
+
+    if (outsiderBound >= limit && size <= NUM_PATTERNS)
+    {
+        lowest = outsiderBound;
+        ctx.pool.clear();
+
+        for (size_t i = begin; i < begin + size; i++)
+            if (ctx.guessable[ctx.scratch[i]])
+                ctx.pool.push_back(ctx.scratch[i]);
+
+        pool = &ctx.pool;
+    }
+
+    for (WordId guess : *pool)
+    {
+        uint32_t counted = 0;
+        bool tooBig = false;
+
+        for (; counted < size && !tooBig; counted++)
+        {
+            Pattern p = ctx.feedback[counted] = lookupResult(dict, guess, ctx.scratch[begin + counted]);
+            tooBig = ++ctx.count[p] > largest && p != ALL_GREEN;
+        }
+
+        if (tooBig)
+        {
+            for (uint32_t i = 0; i < counted; i++)
+                ctx.count[ctx.feedback[i]] = 0;
+
+            continue;
+        }
+
+        // Only the candidates' own feedbacks were counted, so only those need resetting
+        uint32_t bound = size, score = 0;
+        bool splits = ctx.count[ALL_GREEN] > 0;
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            Pattern p = ctx.feedback[i];
+            uint32_t n = ctx.count[p];
+
+            if (n == 0)
+                continue;
+
+            score += n * n;
+            bound += p == ALL_GREEN ? 0 : lowerBound(n);
+            splits = splits || n < size;
+            ctx.count[p] = 0;
+        }
+
+        if (splits && bound < limit)
+            ranked.push_back({ bound, score, guess });
+
+        else if (splits)
+            lowest = min(lowest, bound);
+    }
+
+    sort(ranked.begin(), ranked.end());
+    return lowest;
+}
+
+
+uint32_t solveExact(const Dictionary &dict, SearchContext &ctx, Memo<Bound> &memo,
+                    size_t begin, uint32_t size, size_t top, uint32_t limit, int depth);
+
+
+// Total guesses for the state in scratch[begin, begin + size) if it makes "option" and plays optimally after,
+// as long as that's below "limit"; otherwise some lower bound that's at least "limit"
+uint32_t tryGuess(const Dictionary &dict, SearchContext &ctx, Memo<Bound> &memo, const RankedGuess &option,
+                  size_t begin, uint32_t size, size_t top, uint32_t limit, int depth)
+{
+    uint32_t count[NUM_PATTERNS];
+    uint32_t remaining = partitionState(dict, option.guess, ctx.scratch, begin, size, top, count);
+    uint32_t total = option.bound;
+
+    // Children the table already knows about raise the bound for free
+    struct Child { uint32_t size, begin, bound; };
+    Child children[NUM_PATTERNS];
+    int numChildren = 0;
+
+    for (int p = 0, childBegin = 0; p < NUM_PATTERNS; childBegin += count[p], p++)
+    {
+        if (count[p] == 0)
+            continue;
+
+        Child child = { count[p], uint32_t(childBegin), lowerBound(count[p]) };
+        Bound known;
+
+        if (child.size > 2 && memo.find(stateKey(ctx, &ctx.scratch[top + childBegin], child.size, depth), known) &&
+            known.total > child.bound)
+        {
+            total += known.total - child.bound;
+            child.bound = known.total;
+
+            // Already ruled out, and adding up more INFEASIBLE children could overflow
+            if (total >= limit)
+                return total;
+        }
+
+        children[numChildren++] = child;
+    }
+
+    // Small children are cheap to solve and often enough to rule the guess out
+    sort(children, children + numChildren, [](const Child &a, const Child &b) { return a.size < b.size; });
+
+    // Each child's bound is swapped for its real cost, so "total" only rises toward the answer
+    for (int i = 0; i < numChildren && total < limit; i++)
+    {
+        const Child &child = children[i];
+        total += solveExact(dict, ctx, memo, top + child.begin, child.size, top + remaining,
+                            limit - (total - child.bound), depth) - child.bound;
+    }
+
+    return total;
+}
+
+
+// Fewest total guesses that finish every candidate in scratch[begin, begin + size) (ascending ids),
+// as long as that's below "limit"; otherwise some lower bound that's at least "limit"
+// "top" = where the free part of ctx.scratch starts
+// "depth" = guesses made before this state, for ctx.maxGuesses; states that can't make it cost INFEASIBLE
+// The best guess of every state solved exactly is left in "memo"
+uint32_t solveExact(const Dictionary &dict, SearchContext &ctx, Memo<Bound> &memo,
+                    size_t begin, uint32_t size, size_t top, uint32_t limit, int depth)
+{
+    if (size > capacity(guessesLeft(ctx, depth)))
+        return INFEASIBLE;
+
+    if (size == 1 || lowerBound(size) >= limit)
+        return lowerBound(size);
+
+    // The last candidate is always guessed, but the first of two only if it's on the guess list
+    if (size == 2 && (ctx.guessable[ctx.scratch[begin]] || ctx.guessable[ctx.scratch[begin + 1]]))
+        return lowerBound(size);
+
+    SetKey key = stateKey(ctx, &ctx.scratch[begin], size, depth);
+    Bound known;
+
+    if (memo.find(key, known) && (known.exact || known.total >= limit))
+        return known.total;
+
+    // A candidate that tells all the others apart meets the lower bound, so nothing beats it
+    if (size <= NUM_PATTERNS)
+    {
+        for (size_t i = begin; i < begin + size; i++)
+        {
+            if (!ctx.guessable[ctx.scratch[i]])
+                continue;
+
+            uint64_t seen[4] = {};
+            bool perfect = true;
+
+            for (size_t j = begin; j < begin + size && perfect; j++)
+            {
+                Pattern p = lookupResult(dict, ctx.scratch[i], ctx.scratch[j]);
+                perfect = !(seen[p / 64] >> (p % 64) & 1);
+                seen[p / 64] |= uint64_t(1) << (p % 64);
+            }
+
+            if (perfect)
+            {
+                remember(ctx, memo, key, { lowerBound(size), ctx.scratch[i], true });
+                return lowerBound(size);
+            }
+        }
+    }
+
+    if (ctx.ranked.size() <= size_t(depth))
+        ctx.ranked.resize(depth + 1);
+
+    uint32_t best = limit;
+    int bestGuess = -1;
+
+    // If nothing gets under "limit", the weakest bound any guess was held to is still a bound for the state,
+    // and often a much higher one than "limit", which saves searching this state again for a slightly higher one
+    uint32_t lowest = rankGuesses(dict, ctx, begin, size, limit, depth, ctx.ranked[depth]);
+
+    // Deeper states grow ctx.ranked, so this state's guesses are looked up by index
+    for (size_t i = 0; i < ctx.ranked[depth].size(); i++)
+    {
+        RankedGuess option = ctx.ranked[depth][i];
+
+        if (option.bound >= best)
+        {
+            lowest = min(lowest, option.bound);
+            break;
+        }
+
+        uint32_t total = tryGuess(dict, ctx, memo, option, begin, size, top, best, depth + 1);
+
+        if (total < best)
+        {
+            best = total;
+            bestGuess = option.guess;
+        }
+
+        else
+            lowest = min(lowest, total);
+    }
+
+    if (bestGuess < 0)
+        best = lowest;
+
+    remember(ctx, memo, key, { best, WordId(bestGuess >= 0 ? bestGuess : NO_WORD), bestGuess >= 0 });
+    return best;
+}
+
+
+// Chooses the guess the exact search finds best, looking it up in "memo" and solving the state if it isn't there
+GuessChooser exactChooser(const Dictionary &dict, SearchContext &ctx, Memo<Bound> &memo)
+{
+    return [&dict, &ctx, &memo](const WordId *candidates, uint32_t numCandidates, int depth, const Hints &) -> WordId
+    {
+        if (numCandidates == 2 && (ctx.guessable[candidates[0]] || ctx.guessable[candidates[1]]))
+            return ctx.guessable[candidates[0]] ? candidates[0] : candidates[1];
+
+        SetKey key = stateKey(ctx, candidates, numCandidates, depth);
+        Bound known;
+
+        if (!memo.find(key, known) || !known.exact)
+        {
+            copy(candidates, candidates + numCandidates, ctx.scratch.begin());
+            solveExact(dict, ctx, memo, 0, numCandidates, numCandidates, INFEASIBLE, depth);
+            memo.find(key, known);
+        }
+
+        return known.guess;
+    };
+}
+
+
+// Chooses guesses the way play does: the first guess at the root, getGuess everywhere else
+GuessChooser policyChooser(const Dictionary &dict, SolverContext &ctx, const Strategy &strategy)
+{
+    return [&dict, &ctx, &strategy](const WordId *candidates, uint32_t numCandidates, int depth, const Hints &hints)
+    {
+        if (depth == 0)
+            return strategy.firstGuess;
+
+        ctx.copy.assign(candidates, candidates + numCandidates);
+        const vector<WordId> &words = strategy.hardMode ? hardModeGuesses(dict, ctx, hints, ctx.copy) : dict.guesses;
+        return getGuess(dict, ctx, strategy.policy, words, ctx.copy);
+    };
+}
+
+
+// Builds the tree with the fewest total guesses over every answer, by branch and bound:
+// guesses are tried most promising first, a state stops searching once no guess left can beat its best,
+// and every optimum or proven bound is shared through one table
+// With MINIMAX, the tree's longest game comes first: each cap on it is tried in turn, smallest first,
+// and the first that can be met gets the fewest total guesses within it
+// The opener's guesses are spread over "numThreads" threads
+// "memo" may already hold states from a run that was killed; states found now also go to "checkpoint", if given
+TreeNode *buildOptimalTree(const Dictionary &dict, Arena &arena, Policy policy, int numThreads,
+                           Memo<Bound> &memo, Checkpoint *checkpoint)
+{
+    uint32_t numAnswers = uint32_t(dict.numAnswers);
+    ThreadPool pool(numThreads);
+    vector<SearchContext> contexts;
+    contexts.reserve(pool.size());
+
+    for (int i = 0; i < pool.size(); i++)
+    {
+        contexts.emplace_back(dict);
+        contexts.back().checkpoint = checkpoint;
+    }
+
+    // The greedy strategy's cost is the one to beat
+    Solved greedy;
+
+    {
+        SolverContext ctx(dict);
+        Memo<Solved> memo;
+        vector<WordId> scratch = contexts[0].scratch;
+        greedy = solveState(dict, ctx, policy, memo, scratch, 0, numAnswers, numAnswers);
+    }
+
+    uint32_t best;
+    vector<RankedGuess> openers;
+    mutex m;
+    size_t bestRank;
+
+    // Searches every opener for a total under "toBeat" with games capped at "maxGuesses" (0 for no cap)
+    auto search = [&](int maxGuesses, uint32_t toBeat)
+    {
+        for (SearchContext &ctx : contexts)
+            ctx.maxGuesses = maxGuesses;
+
+        best = toBeat;
+        rankGuesses(dict, contexts[0], 0, numAnswers, best, 0, openers);
+
+        // Among openers that tie, the one ranked first wins, so the tree doesn't depend on thread timing
+        bestRank = openers.size();
+
+        pool.parallelFor(openers.size(), [&](int worker, size_t rank)
+        {
+            uint32_t limit;
+
+            {
+                lock_guard<mutex> lock(m);
+                limit = best + (rank < bestRank);
+            }
+
+            if (openers[rank].bound >= limit)
+                return;
+
+            uint32_t total = tryGuess(dict, contexts[worker], memo, openers[rank], 0, numAnswers, numAnswers, limit, 1);
+            lock_guard<mutex> lock(m);
+
+            if (total < best + (rank < bestRank))
+            {
+                best = total;
+                bestRank = rank;
+            }
+        });
+
+        return bestRank < openers.size();
+    };
+
+    bool found = false;
+
+    // Caps below the greedy tree's longest game have no known tree to beat
+    // The opener ranked first may tie the limit, so the limit stays below INFEASIBLE
+    if (policy == MINIMAX)
+        for (int maxGuesses = 1; maxGuesses < int(greedy.maxGuesses) && !found; maxGuesses++)
+            found = capacity(maxGuesses) >= numAnswers && search(maxGuesses, INFEASIBLE - 1);
+
+    if (!found)
+        search(policy == MINIMAX ? greedy.maxGuesses : 0, greedy.total + 1);
+
+    // Every state on the winning line was solved exactly on the way, so the tree is read off the table
+    GuessChooser solved = exactChooser(dict, contexts[0], memo);
+
+    GuessChooser chooseGuess = [&](const WordId *candidates, uint32_t numCandidates, int depth, const Hints &hints)
+    {
+        return depth == 0 && bestRank < openers.size() ? openers[bestRank].guess : solved(candidates, numCandidates, depth, hints);
+    };
+
+    TreeNode *root = arena.allocate<TreeNode>(1);
+    WordId *candidates = arena.allocate<WordId>(numAnswers);
+    iota(candidates, candidates + numAnswers, 0);
+
+    buildNode(dict, arena, chooseGuess, *root, candidates, numAnswers, 0);
+    return root;
+}
+
+
+// Builds the strategy play follows for every answer, allocated entirely in "arena"
+// With strategy.optimal, builds the exact optimum instead, using "numThreads" threads,
+// starting from the states in "memo" and saving new ones to "checkpoint" (see buildOptimalTree), if given
+TreeNode *buildTree(const Dictionary &dict, SolverContext &ctx, Arena &arena, const Strategy &strategy, int numThreads = 1,
+                    Memo<Bound> *memo = nullptr, Checkpoint *checkpoint = nullptr)
+{
+    if (strategy.optimal)
+    {
+        Memo<Bound> fresh;
+        return buildOptimalTree(dict, arena, strategy.policy, numThreads, memo ? *memo : fresh, checkpoint);
+    }
+
+    GuessChooser chooseGuess = policyChooser(dict, ctx, strategy);
+    TreeNode *root = arena.allocate<TreeNode>(1);
+    WordId *candidates = arena.allocate<WordId>(dict.numAnswers);
+    iota(candidates, candidates + dict.numAnswers, 0);
+
+    buildNode(dict, arena, chooseGuess, *root, candidates, uint32_t(dict.numAnswers), 0);
+    return root;
+}
+
+
+// What repairTree reused and what it had to solve again
+struct RepairCounts
+{
+    size_t kept = 0;       // nodes that kept their old guess
+    size_t solved = 0;     // subtrees solved from scratch
+    size_t rebuilt = 0;    // nodes in those subtrees
+};
+
+
+size_t countNodes(const TreeNode &node)
+{
+    size_t count = 1;
+
+    for (int i = 0; i < node.numChildren; i++)
+        count += countNodes(node.children[i]);
+
+    return count;
+}
+
+
+// Fills in "node" for "candidates" by following the old tree's node "old" for the same state (nullptr if it had none)
+// An old guess stays as long as it's still a guess and still narrows the candidates down, so a subtree the
+// word list change didn't touch is copied as it was, without scoring a single guess; states the old tree
+// can't handle, like new feedbacks or leaves that gained candidates, are solved from scratch with "chooseGuess"
+// In "hardMode" the old guess must also still use "hints"
+void repairNode(const Dictionary &dict, Arena &arena, const MappedTree &tree, const vector<char> &guessable, bool hardMode,
+                const GuessChooser &chooseGuess, const MappedTree::Node *old, TreeNode &node,
+                WordId *candidates, uint32_t numCandidates, int depth, const Hints &hints, RepairCounts &counts)
+{
+    WordId guess = old ? tree.guess(*old) : NO_WORD;
+    bool keep = numCandidates == 1 ? guess == candidates[0] : guess != NO_WORD && guessable[guess];
+    keep &= !hardMode || guess == NO_WORD || usesHints(dict, hints, guess);
+
+    // The guess must solve a candidate or tell two of them apart
+    if (keep && numCandidates > 1)
+    {
+        Pattern first = getResult(dict, guess, candidates[0]);
+        bool narrows = first == ALL_GREEN;
+
+        for (uint32_t i = 1; i < numCandidates && !narrows; i++)
+        {
+            Pattern result = getResult(dict, guess, candidates[i]);
+            narrows = result == ALL_GREEN || result != first;
+        }
+
+        keep = narrows;
+    }
+
+    if (!keep)
+    {
+        buildNode(dict, arena, chooseGuess, node, candidates, numCandidates, depth, hints);
+        counts.solved++;
+        counts.rebuilt += countNodes(node);
+        return;
+    }
+
+    splitNode(dict, arena, node, candidates, numCandidates, guess);
+    counts.kept++;
+
+    for (int i = 0; i < node.numChildren; i++)
+    {
+        TreeNode &child = node.children[i];
+        Hints childHints = hints;
+        addHints(childHints, dict.letters[guess], node.patterns[i]);
+        repairNode(dict, arena, tree, guessable, hardMode, chooseGuess, tree.child(*old, node.patterns[i]), child,
+                   child.candidates, child.numCandidates, depth + 1, childHints, counts);
+    }
+}
+
+
+// Rebuilds a saved tree for the current answer list, reusing it wherever the changes allow
+// New states are solved the way buildTree would, exactly with strategy.optimal
+TreeNode *repairTree(const Dictionary &dict, SolverContext &ctx, Arena &arena, const Strategy &strategy,
+                     const MappedTree &tree, RepairCounts &counts)
+{
+    vector<char> guessable(dict.text.size());
+
+    for (WordId guess : dict.guesses)
+        guessable[guess] = true;
+
+    SearchContext search(dict);
+    Memo<Bound> memo;
+    GuessChooser chooseGuess = strategy.optimal ? exactChooser(dict, search, memo) : policyChooser(dict, ctx, strategy);
+
+    TreeNode *root = arena.allocate<TreeNode>(1);
+    WordId *candidates = arena.allocate<WordId>(dict.numAnswers);
+    iota(candidates, candidates + dict.numAnswers, 0);
+
+    repairNode(dict, arena, tree, guessable, strategy.hardMode, chooseGuess, &tree.node(0), *root, candidates,
+               uint32_t(dict.numAnswers), 0, Hints(), counts);
+    return root;
+}
+
+
+// Checks "tree" against the dictionary without replaying any games:
+// every node is well formed, every answer's walk follows its real feedback to a node that guesses it,
+// each node's candidate count is the number of answers that reach it, and the header's statistics are right
+// Answers and nodes are checked in parallel; returns every inconsistency, each with the node it's on
+vector<string> checkTree(const Dictionary &dict, const MappedTree &tree, int numThreads, Stats &totals)
+{
+    ThreadPool pool(numThreads);
+    vector<vector<string>> issues(pool.size());
+    vector<vector<uint32_t>> visits(pool.size(), vector<uint32_t>(tree.numNodes));
+    vector<Stats> stats(pool.size());
+
+    auto describe = [&](const MappedTree::Node &node)
+    {
+        return "node " + to_string(tree.indexOf(node)) + " (" + tree.text(node) + "): ";
+    };
+
+    pool.parallelFor(tree.numNodes, [&](int worker, size_t i)
+    {
+        const MappedTree::Node &node = tree.node(i);
+
+        if (tree.guess(node) == NO_WORD)
+            issues[worker].push_back(describe(node) + "guess isn't in the dictionary");
+
+        if (!tree.childrenInPlace(node))
+        {
+            issues[worker].push_back(describe(node) + "children are out of place");
+            return;
+        }
+
+        if ((node.numChildren == 0) != (node.numCandidates == 1))
+            issues[worker].push_back(describe(node) + to_string(node.numCandidates) + " candidates but " +
+                                     to_string(node.numChildren) + " children");
+
+        uint64_t totalGuesses = node.numCandidates;
+
+        for (uint32_t j = node.firstChild; j < node.firstChild + node.numChildren; j++)
+        {
+            if (tree.patternTo(j) == ALL_GREEN || (j > node.firstChild && tree.patternTo(j) <= tree.patternTo(j - 1)))
+                issues[worker].push_back(describe(node) + "feedbacks to children aren't distinct and ascending");
+
+            totalGuesses += tree.node(j).totalGuesses;
+        }
+
+        if (totalGuesses != node.totalGuesses)
+            issues[worker].push_back(describe(node) + "says its candidates take " + to_string(node.totalGuesses) +
+                                     " guesses, but its children add up to " + to_string(totalGuesses));
+    });
+
+    WordId opener = tree.guess(tree.node(0));
+
+    pool.parallelFor(dict.numAnswers, [&](int worker, size_t answer)
+    {
+        const MappedTree::Node *node = &tree.node(0);
+
+        for (int depth = 1; ; depth++)
+        {
+            visits[worker][tree.indexOf(*node)]++;
+            WordId guess = tree.guess(*node);
+
+            if (guess == answer)
+            {
+                stats[worker].add(depth, opener == NO_WORD ? 0 : getResult(dict, opener, WordId(answer)));
+                break;
+            }
+
+            if (guess == NO_WORD)
+                break;
+
+            Pattern result = getResult(dict, guess, WordId(answer));
+            const MappedTree::Node *child = tree.child(*node, result);
+
+            if (!child)
+            {
+                issues[worker].push_back(describe(*node) + dict.text[answer] + " gives " + patternString(result) +
+                                         ", which has no branch");
+                break;
+            }
+
+            node = child;
+        }
+    });
+
+    // Every answer that passes through a node is one of its candidates, and only those are
+    for (size_t worker = 1; worker < visits.size(); worker++)
+    {
+        for (size_t i = 0; i < tree.numNodes; i++)
+            visits[0][i] += visits[worker][i];
+
+        stats[0].merge(stats[worker]);
+        issues[0].insert(issues[0].end(), issues[worker].begin(), issues[worker].end());
+    }
+
+    for (size_t i = 0; i < tree.numNodes; i++)
+        if (visits[0][i] != tree.node(i).numCandidates)
+            issues[0].push_back(describe(tree.node(i)) + "has " + to_string(tree.node(i).numCandidates) +
+                                " candidates, but " + to_string(visits[0][i]) + " answers reach it");
+
+    if (stats[0].sum != tree.header.totalGuesses || stats[0].maxGuesses != int(tree.header.maxGuesses))
+        issues[0].push_back("header says " + to_string(tree.header.totalGuesses) + " guesses in total and at most " +
+                            to_string(tree.header.maxGuesses) + ", but the answers take " + to_string(stats[0].sum) +
+                            " and at most " + to_string(stats[0].maxGuesses));
+
+    totals = stats[0];
+    return issues[0];
+}
+
+
+// A guess getGuess made for a state off the tree
+struct Suggested
+{
+    WordId guess;
+
+    // getGuess is deterministic, so every result for a state is the same
+    bool improves(const Suggested &) const { return false; }
+};
+
+
+// What live solving shares between games: the dictionary, the strategy, its tree and the states solved off it
+// Only the table of solved states changes once open, and it's thread-safe, so any number of sessions
+// on any number of threads can use one engine at once
+// The table keeps at most "maxStates" states, so a long-running server's memory stays bounded
+class Engine
+{
+public:
+    const Dictionary &dict;
+    const Strategy strategy;
+
+    Engine(const Dictionary &dict, const Strategy &strategy, size_t maxStates)
+        : dict(dict), strategy(strategy), solved(maxStates) {}
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    // Builds the strategy's tree, or maps the saved tree "treeFile" if there is one,
+    // which is checked against the dictionary once here and then served straight from the file
+    // Returns an error message, or "" on success
+    string open(const string &treeFile, int numThreads)
+    {
+        if (treeFile.empty())
+        {
+            SolverContext ctx(dict);
+            Arena arena;
+            const TreeNode *root = buildTree(dict, ctx, arena, strategy, numThreads);
+            return tree.load(encodeTree(dict, *root, hashStrategy(dict, strategy)), dict);
+        }
+
+        string error = tree.open(treeFile, dict);
+
+        if (error.empty())
+            error = strategyMismatch(tree, dict, strategy, treeFile);
+
+        if (!error.empty())
+            return error;
+
+        Stats stats;
+        vector<string> issues = checkTree(dict, tree, numThreads, stats);
+
+        if (!issues.empty())
+            return treeFile + " doesn't match the answer list (" + issues[0] + "); --verify-tree lists every problem " +
+                   "and --repair-tree updates it";
+
+        return "";
+    }
+
+    // Guesses for states off the tree, so each is only solved once, by whichever session gets there first
+    mutable Memo<Suggested> solved;
+
+    MappedTree tree;
+};
+
+
+// One game being solved live, from the guesses and feedback it's been given so far
+// While they follow the tree, every step is a lookup; after that, the answers are filtered and solved as play would
+struct Session
+{
+    const MappedTree::Node *node = nullptr;   // the game's state in the engine's tree, nullptr once it's left it
+    Knowledge k;
+    Hints hints;
+    int numGuesses = 0;
+    vector<WordId> candidates;        // answers that fit the feedback, once off the tree
+};
+
+
+// Starts a new game in "session"
+void startSession(const Engine &engine, Session &session)
+{
+    session.node = &engine.tree.root();
+    session.k = Knowledge();
+    session.hints = Hints();
+    session.numGuesses = 0;
+    session.candidates.clear();
+}
+
+
+// Answers that still fit the feedback
+size_t numLeft(const Session &session)
+{
+    return session.node ? session.node->numCandidates : session.candidates.size();
+}
+
+
+// Key for the state of a session off the tree
+// In hard mode the hints narrow the guesses too, so they're part of the state
+SetKey sessionKey(const Engine &engine, const Session &session)
+{
+    const Hints &hints = session.hints;
+    uint64_t salt = 0;
+
+    if (engine.strategy.hardMode)
+        salt = hashBytes(hints.green, sizeof(hints.green), hashBytes(&hints.required, sizeof(hints.required)));
+
+    return makeKey(session.candidates.data(), uint32_t(session.candidates.size()), salt);
+}
+
+
+// The guess to make next, or NO_WORD if no answer fits the feedback
+WordId suggest(const Engine &engine, SolverContext &ctx, const Session &session)
+{
+    if (session.node)
+        return engine.tree.guess(*session.node);
+
+    const vector<WordId> &copy = session.candidates;
+
+    if (copy.size() <= 1)
+        return copy.empty() ? NO_WORD : copy[0];
+
+    const Dictionary &dict = engine.dict;
+    SetKey key = sessionKey(engine, session);
+    Suggested known;
+
+    if (engine.solved.find(key, known))
+        return known.guess;
+
+    const vector<WordId> &words = engine.strategy.hardMode ? hardModeGuesses(dict, ctx, session.hints, copy) : dict.guesses;
+    WordId guess = getGuess(dict, ctx, engine.strategy.policy, words, copy);
+    engine.solved.insert(key, { guess });
+    return guess;
+}
+
+
+// Records that the guess with letters "guess" got the feedback "result", as the real game gives it
+// The guess doesn't have to be the one suggested, or even in the dictionary
+void addGuess(const Engine &engine, Session &session, const array<uint8_t, 5> &guess, Pattern result)
+{
+    const Dictionary &dict = engine.dict;
+    addFeedback(session.k, guess, result, WORDLE_RULES);
+    addHints(session.hints, guess, result);
+    session.numGuesses++;
+
+    // The tree only has a state for the guess it made, and for feedback some candidate gives
+    if (const MappedTree::Node *node = session.node)
+    {
+        const array<uint8_t, 5> &expected = dict.letters[engine.tree.guess(*node)];
+        const MappedTree::Node *child = nullptr;
+        session.node = nullptr;
+
+        if (equal(guess.begin(), guess.end(), expected.begin()))
+            child = engine.tree.child(*node, looseResult(guess, result));
+
+        // The tree's states follow getResult's feedback, which is the game's when the guess has 5 different letters
+        if (child && __builtin_popcount(dict.masks[engine.tree.guess(*node)]) == 5)
+        {
+            session.node = child;
+            return;
+        }
+
+        // Otherwise the game's feedback can tell some of the child's candidates apart, and the game leaves the tree
+        filterWords(dict, session.k, dict.numAnswers, session.candidates);
+
+        if (child && session.candidates.size() == child->numCandidates)
+        {
+            session.node = child;
+            session.candidates.clear();
+        }
+
+        return;
+    }
+
+    // Only the answers that fit the feedback before can fit it now
+    vector<WordId> &candidates = session.candidates;
+    candidates.erase(remove_if(candidates.begin(), candidates.end(),
+                               [&](WordId id) { return !matches(dict, session.k, id); }), candidates.end());
+}
+
+
+// A finished game as a checkpoint record: word, # of guesses, then each guess
+vector<uint8_t> encodeGame(WordId word, int numGuesses, const vector<WordId> &guesses)
+{
+    vector<uint8_t> data(sizeof(WordId) + 2 + guesses.size() * sizeof(WordId));
+    memcpy(&data[0], &word, sizeof(WordId));
+    data[sizeof(WordId)] = uint8_t(numGuesses);
+    data[sizeof(WordId) + 1] = uint8_t(guesses.size());
+    memcpy(&data[sizeof(WordId) + 2], guesses.data(), guesses.size() * sizeof(WordId));
+    return data;
+}
+
+
+// Reads a record written by encodeGame; false if it's malformed
+bool decodeGame(const uint8_t *data, uint32_t size, GameResult &game)
+{
+    if (size < sizeof(WordId) + 2)
+        return false;
+
+    memcpy(&game.word, data, sizeof(WordId));
+    game.numGuesses = data[sizeof(WordId)];
+    game.guesses.resize(data[sizeof(WordId) + 1]);
+
+    if (size != sizeof(WordId) + 2 + game.guesses.size() * sizeof(WordId))
+        return false;
+
+    memcpy(game.guesses.data(), data + sizeof(WordId) + 2, game.guesses.size() * sizeof(WordId));
+    return true;
+}
+
+
+// How one opener fares, as ranked by --rank-openers
+// Self-contained so it can go into checkpoint and partial files as is
+struct OpenerScore
+{
+    char word[8];
+    uint32_t order;        // place in the guess list, the final tie-break
+    uint32_t expected;     // getGuess's score for it at the start: the sum of squared bucket sizes
+    uint32_t numResults;   // distinct feedbacks it can get
+    uint32_t numAnswers;
+    uint32_t total;        // guesses over every answer when opening with it, or 0 if not simulated
+    uint32_t maxGuesses;
+};
+
+
+// Ranks by full simulation when there is one, else by the one-step score
+bool operator<(const OpenerScore &a, const OpenerScore &b)
+{
+    if (a.total != b.total)
+        return a.total < b.total;
+
+    if (a.maxGuesses != b.maxGuesses)
+        return a.maxGuesses < b.maxGuesses;
+
+    if (a.expected != b.expected)
+        return a.expected < b.expected;
+
+    return a.order < b.order;
+}
+
+
+// One-step score of "opener", plus the full sweep with it if "simulate"
+OpenerScore scoreOpener(const Dictionary &dict, SolverContext &ctx, Policy policy, Memo<Solved> &memo,
+                        vector<WordId> &scratch, WordId opener, uint32_t order, bool simulate)
+{
+    OpenerScore score = {};
+    strncpy(score.word, dict.text[opener].c_str(), sizeof(score.word) - 1);
+    score.order = order;
+    score.numAnswers = uint32_t(dict.numAnswers);
+
+    uint32_t count[NUM_PATTERNS] = {};
+
+    for (size_t answer = 0; answer < dict.numAnswers; answer++)
+        count[lookupResult(dict, opener, WordId(answer))]++;
+
+    for (uint32_t n : count)
+    {
+        score.expected += n * n;
+        score.numResults += n != 0;
+    }
+
+    if (simulate)
+    {
+        if (scratch.size() < dict.numAnswers)
+            scratch.resize(dict.numAnswers);
+
+        iota(scratch.begin(), scratch.begin() + dict.numAnswers, 0);
+        Solved solved = solveState(dict, ctx, policy, memo, scratch, 0, uint32_t(dict.numAnswers), dict.numAnswers, opener);
+        score.total = solved.total;
+        score.maxGuesses = solved.maxGuesses;
+    }
+
+    return score;
+}
+
+
+// Prints the ranking (best first) in the given mode; "top" = rows to print, 0 for all
+void printRanking(Writer &out, const vector<OpenerScore> &scores, OutputMode mode, size_t top)
+{
+    size_t rows = top ? min(top, scores.size()) : scores.size();
+
+    if (mode == CSV)
+        out << "rank,opener,average,max,expected_left,feedbacks\n";
+
+    else if (mode != JSONL)
+        out << "Rank  Opener  Average  Max  Expected Left  Feedbacks\n";
+
+    for (size_t i = 0; i < rows; i++)
+    {
+        const OpenerScore &score = scores[i];
+        double average = score.total ? double(score.total) / score.numAnswers : 0;
+        double expectedLeft = double(score.expected) / score.numAnswers;
+
+        if (mode == CSV)
+            out.format("%zu,%s,%.4f,%u,%.2f,%u\n", i + 1, score.word, average, score.maxGuesses, expectedLeft, score.numResults);
+
+        else if (mode == JSONL)
+            out.format("{\"rank\":%zu,\"opener\":\"%s\",\"average\":%.4f,\"max\":%u,\"expected_left\":%.2f,\"feedbacks\":%u}\n",
+                       i + 1, score.word, average, score.maxGuesses, expectedLeft, score.numResults);
+
+        else if (score.total)
+            out.format("%4zu  %-6s  %7.4f  %3u  %13.2f  %9u\n", i + 1, score.word, average, score.maxGuesses, expectedLeft, score.numResults);
+
+        else
+            out.format("%4zu  %-6s  %7s  %3s  %13.2f  %9u\n", i + 1, score.word, "-", "-", expectedLeft, score.numResults);
+    }
+}
+
+
+#ifdef WORDLEBOT_COUNT_ALLOCS
+// Plays every game with a counting allocator installed and fails if any game allocates
+int checkAllocations(const Dictionary &dict, SolverContext &ctx, const Strategy &strategy, const vector<WordId> &answers)
+{
+    int failures = 0;
+
+    for (WordId word : answers)
+    {
+        size_t before = numAllocations;
+        play(dict, ctx, strategy, word);
+        size_t allocations = numAllocations - before;
+
+        if (allocations != 0)
+        {
+            cout << dict.text[word] << ": " << allocations << " heap allocations" << endl;
+            failures++;
+        }
+    }
+
+    cout << answers.size() - failures << "/" << answers.size() << " games ran without allocating" << endl;
+    return failures == 0 ? 0 : 1;
+}
+#else
+// Other builds have no counter to check with
+int checkAllocations(const Dictionary &, SolverContext &, const Strategy &, const vector<WordId> &)
+{
+    cerr << "--check-allocs needs a build with the counting allocator: make check, or g++ -DWORDLEBOT_COUNT_ALLOCS ..." << endl;
+    return 1;
+}
+#endif
+
+
+// Start of every file written by --partial
+struct ShardHeader
+{
+    char magic[8];          // says what follows
+    uint64_t fingerprint;   // hashStrategy of the run
+    uint32_t shard;
+    uint32_t numShards;
+};
+
+const char PARTIAL_MAGIC[8] = { 'W', 'B', 'P', 'A', 'R', 'T', '0', '1' };
+const char RANKING_MAGIC[8] = { 'W', 'B', 'R', 'A', 'N', 'K', '0', '1' };
+
+
+// One shard's share of a sweep, combined with the others by "wordlebot merge"
+// Stats is plain integers, so it's stored as is; partial files are meant for the same build and platform
+struct Partial
+{
+    ShardHeader header;
+    char opener[8];
+    Stats stats;
+};
+
+
+// Writes the header, then "size" bytes of "data"
+// Returns an error message, or "" on success
+string writeShardFile(const string &path, const char *magic, uint64_t fingerprint, int shard, int numShards,
+                      const void *data, size_t size)
+{
+    ShardHeader header = {};
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.fingerprint = fingerprint;
+    header.shard = shard;
+    header.numShards = numShards;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    bool ok = file && fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == size;
+
+    if (file)
+        ok = fclose(file) == 0 && ok;
+
+    return ok ? "" : "Couldn't write " + path;
+}
+
+
+// Everything main reads from the command line
+struct Options
+{
+    string answersFile = "wordlewords.txt";
+    string guessesFile;
+    string gamesFile;
+    string gameWord;
+    string opener;            // "" = RAISE if the dictionary has it
+    int rangeFirst = 0;
+    int rangeLast = 0;
+    Policy policy = EXPECTED;
+    int numThreads = max(1u, thread::hardware_concurrency());
+    bool treeSweep = false;
+    bool optimal = false;     // trees are the exact optimum rather than the policy's
+    bool hardMode = false;    // guesses have to use every hint revealed so far
+    string buildTreeFile;     // write the strategy tree here and exit
+    string treeFile;          // play by looking guesses up in this tree
+    string verifyTreeFile;    // check this tree against the dictionary and exit
+    string repairTreeFile;    // --build-tree starts from this tree instead of from scratch
+    string exportFormat;      // "json" or "dot": write the --tree-file tree to stdout and exit
+    string rankOpeners;       // "", "quick" (one-step score only) or "full"
+    size_t top = 0;
+    string checkpointFile;
+    double checkpointInterval = 30;
+    bool resume = false;
+    int shard = 0;
+    int numShards = 1;
+    string partialFile;
+    int maxAllowed = 6;
+    bool showBuckets = false;
+    OutputMode mode = VERBOSE;
+    bool checkAllocs = false;
+    bool checkDeterminism = false;
+    bool interactive = false;   // solve a real game from stdin instead of playing the answers
+    string socketPath;          // serve games on this UNIX domain socket instead
+    size_t maxGames = 100000;   // games the server keeps at once
+    int maxConnections = 256;   // clients the server serves at once
+    double idleTimeout = 600;   // seconds before the server drops an unused game or a silent client
+    size_t maxStates = 1000000; // states solved off the tree that live solving keeps at once
+    string batchFile;           // answer the histories in this file ("-" for stdin) instead
+    string kernel = "simd";   // "simd" = feedback matrix and SIMD filter, "scalar" = neither
+};
+
+
+// Sets "policy" from its command line name, or returns false if there's no such policy
+bool parsePolicy(const string &name, Policy &policy)
+{
+    if (name == "expected")
+        policy = EXPECTED;
+
+    else if (name == "partitions")
+        policy = PARTITIONS;
+
+    else if (name == "minimax")
+        policy = MINIMAX;
+
+    else
+        return false;
+
+    return true;
+}
+
+
+const char *USAGE =
+    "Usage: wordlebot [options]\n"
+    "  --answers FILE       words that could be the Wordle (default wordlewords.txt)\n"
+    "  --guesses FILE       words the bot may guess (default: the answers)\n"
+    "  --range FIRST:LAST   only play Wordles FIRST..LAST of the answer list, counting from 1\n"
+    "  --games FILE         only play the answers listed in FILE\n"
+    "  --word WORD          only play WORD\n"
+    "  --opener WORD|auto   first guess (default RAISE, or computed if it isn't a guess)\n"
+    "  --policy NAME        expected (fewest answers left on average), partitions (most feedbacks)\n"
+    "                       or minimax (fewest answers left in the worst case)\n"
+    "  --threads N          worker threads (default: one per core)\n"
+    "  --tree               solve each game state once and read the games off the tree\n"
+    "  --optimal            use the tree with the fewest total guesses, found by exact search (implies --tree)\n"
+    "  --hard               hard mode: every guess after the first keeps the greens and uses the yellows found so far\n"
+    "  --build-tree FILE    save the strategy's decision tree to FILE and exit\n"
+    "  --tree-file FILE     play by looking guesses up in a saved tree, solving live where it has no answer\n"
+    "  --repair-tree FILE   with --build-tree, update the tree in FILE for a changed answer list instead of starting over\n"
+    "  --export json|dot    with --tree-file, write the tree as nested JSON or Graphviz DOT to stdout\n"
+    "  --verify-tree FILE   check a saved tree against the answer list, then exit\n"
+    "  --rank-openers MODE  rank every guess as the opener instead: quick (one-step score) or full (whole sweep)\n"
+    "  --top N              only print the N best openers\n"
+    "  --max-guesses N      games needing more guesses count as failures (default 6)\n"
+    "  --buckets            break the statistics down by the response to the first guess\n"
+    "  --checkpoint FILE    record finished games (or openers, or --optimal's solved states) in FILE as the run goes\n"
+    "  --checkpoint-every S seconds between checkpoint writes (default 30)\n"
+    "  --resume             continue from the work already in the checkpoint file\n"
+    "  --shard K/N          only play the answers (or rank the openers) whose index is K modulo N\n"
+    "  --partial FILE       write this shard's results to FILE for \"wordlebot merge\"\n"
+    "  --quiet              only print the statistics\n"
+    "  --csv, --jsonl       print one structured record per game (or opener)\n"
+    "  --kernel simd|scalar use the feedback matrix and SIMD filter, or neither (default simd)\n"
+    "  --check-allocs       check that games never allocate, then exit (needs -DWORDLEBOT_COUNT_ALLOCS)\n"
+    "  --check-determinism  check that results don't depend on threads, kernel or --tree, then exit\n"
+    "  --interactive        help solve a real game: type each guess and its feedback, get the next guess\n"
+    "  --serve PATH         serve games to any number of clients over a UNIX domain socket at PATH\n"
+    "  --max-games N        with --serve, games kept at once (default 100000)\n"
+    "  --max-connections N  with --serve, clients served at once (default 256)\n"
+    "  --idle-timeout S     with --serve, seconds before an unused game or a silent client is dropped (default 600)\n"
+    "  --max-states N       with --serve, --interactive or --batch, states solved off the tree kept at once (default 1000000)\n"
+    "  --batch FILE|-       print the next guess for every history (\"RAISE 00102 CLOUT 10000\") in FILE, one per line\n"
+    "\n"
+    "       wordlebot merge [--max-guesses N] [--buckets] [--top N] [--csv | --jsonl] FILE...\n"
+    "  combines the --partial files of every shard into the final results\n";
+
+
+// Returns false if the command line isn't valid
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--answers" && hasValue)
+            options.answersFile = argv[++i];
+
+        else if (arg == "--guesses" && hasValue)
+            options.guessesFile = argv[++i];
+
+        else if (arg == "--range" && hasValue && sscanf(argv[i + 1], "%d:%d", &options.rangeFirst, &options.rangeLast) == 2)
+            i++;
+
+        else if (arg == "--games" && hasValue)
+            options.gamesFile = argv[++i];
+
+        else if (arg == "--word" && hasValue)
+            options.gameWord = argv[++i];
+
+        else if (arg == "--opener" && hasValue)
+            options.opener = argv[++i];
+
+        else if (arg == "--policy" && hasValue && parsePolicy(argv[i + 1], options.policy))
+            i++;
+
+        else if (arg == "--threads" && hasValue)
+            options.numThreads = max(1, atoi(argv[++i]));
+
+        else if (arg == "--tree")
+            options.treeSweep = true;
+
+        else if (arg == "--optimal")
+            options.optimal = options.treeSweep = true;
+
+        else if (arg == "--hard")
+            options.hardMode = true;
+
+        else if (arg == "--build-tree" && hasValue)
+            options.buildTreeFile = argv[++i];
+
+        else if (arg == "--tree-file" && hasValue)
+            options.treeFile = argv[++i];
+
+        else if (arg == "--verify-tree" && hasValue)
+            options.verifyTreeFile = argv[++i];
+
+        else if (arg == "--repair-tree" && hasValue)
+            options.repairTreeFile = argv[++i];
+
+        else if (arg == "--export" && hasValue && (strcmp(argv[i + 1], "json") == 0 || strcmp(argv[i + 1], "dot") == 0))
+            options.exportFormat = argv[++i];
+
+        else if (arg == "--rank-openers" && hasValue && (strcmp(argv[i + 1], "quick") == 0 || strcmp(argv[i + 1], "full") == 0))
+            options.rankOpeners = argv[++i];
+
+        else if (arg == "--top" && hasValue)
+            options.top = max(0, atoi(argv[++i]));
+
+        else if (arg == "--max-guesses" && hasValue)
+            options.maxAllowed = atoi(argv[++i]);
+
+        else if (arg == "--buckets")
+            options.showBuckets = true;
+
+        else if (arg == "--checkpoint" && hasValue)
+            options.checkpointFile = argv[++i];
+
+        else if (arg == "--checkpoint-every" && hasValue)
+            options.checkpointInterval = atof(argv[++i]);
+
+        else if (arg == "--resume")
+            options.resume = true;
+
+        else if (arg == "--shard" && hasValue && sscanf(argv[i + 1], "%d/%d", &options.shard, &options.numShards) == 2 &&
+                 options.numShards > 0 && options.shard >= 0 && options.shard < options.numShards)
+            i++;
+
+        else if (arg == "--partial" && hasValue)
+            options.partialFile = argv[++i];
+
+        else if (arg == "--quiet")
+            options.mode = QUIET;
+
+        else if (arg == "--csv")
+            options.mode = CSV;
+
+        else if (arg == "--jsonl")
+            options.mode = JSONL;
+
+        else if (arg == "--kernel" && hasValue && (strcmp(argv[i + 1], "simd") == 0 || strcmp(argv[i + 1], "scalar") == 0))
+            options.kernel = argv[++i];
+
+        else if (arg == "--check-allocs")
+            options.checkAllocs = true;
+
+        else if (arg == "--check-determinism")
+            options.checkDeterminism = true;
+
+        else if (arg == "--interactive")
+            options.interactive = true;
+
+        else if (arg == "--serve" && hasValue)
+            options.socketPath = argv[++i];
+
+        else if (arg == "--max-games" && hasValue)
+            options.maxGames = max(1, atoi(argv[++i]));
+
+        else if (arg == "--max-states" && hasValue)
+            options.maxStates = max(1, atoi(argv[++i]));
+
+        else if (arg == "--max-connections" && hasValue)
+            options.maxConnections = max(1, atoi(argv[++i]));
+
+        else if (arg == "--idle-timeout" && hasValue)
+            options.idleTimeout = max(1.0, atof(argv[++i]));
+
+        else if (arg == "--batch" && hasValue)
+            options.batchFile = argv[++i];
+
+        else
+            return false;
+    }
+
+    if (options.resume && options.checkpointFile.empty())
+    {
+        cerr << "--resume needs --checkpoint FILE" << endl;
+        return false;
+    }
+
+    // A tree's checkpoint holds the exact search's states; the greedy tree takes seconds and has none to save
+    bool buildsTree = options.treeSweep || !options.buildTreeFile.empty();
+
+    if (!options.checkpointFile.empty() && buildsTree && (!options.optimal || !options.repairTreeFile.empty()))
+    {
+        cerr << "--checkpoint with --tree or --build-tree needs --optimal (and no --repair-tree)" << endl;
+        return false;
+    }
+
+    // The exact search and opener ranking share solved states between games, and hard mode makes a state
+    // depend on the hints as well as the candidates
+    if (options.hardMode && (options.optimal || !options.rankOpeners.empty()))
+    {
+        cerr << "--hard doesn't work with --optimal or --rank-openers" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+// Picks the answers to play from --games, --word, --range and --shard
+// Returns an error message, or "" on success
+string selectAnswers(const Dictionary &dict, const Options &options, vector<WordId> &answers)
+{
+    if (!options.gameWord.empty() || !options.gamesFile.empty())
+    {
+        vector<string> list = options.gamesFile.empty() ? vector<string>() : loadWords(options.gamesFile);
+
+        if (!options.gameWord.empty())
+            list.push_back(options.gameWord);
+
+        // Each answer is played once, however often it's listed, since games are matched to answers by word
+        vector<char> listed(dict.numAnswers);
+
+        for (string word : list)
+        {
+            int id = findWord(dict, word);
+
+            if (id < 0 || size_t(id) >= dict.numAnswers)
+                return word + " isn't in the answer list";
+
+            if (!listed[id])
+                answers.push_back(WordId(id));
+
+            listed[id] = true;
+        }
+    }
+
+    else
+    {
+        int first = options.rangeFirst > 0 ? options.rangeFirst : 1;
+        int last = options.rangeLast > 0 ? min(options.rangeLast, int(dict.numAnswers)) : int(dict.numAnswers);
+
+        for (int i = first; i <= last; i++)
+            answers.push_back(WordId(i - 1));
+    }
+
+    // Shards split the answers round-robin so each gets a similar mix of easy and hard games
+    if (options.numShards > 1)
+    {
+        vector<WordId> mine;
+
+        for (size_t i = options.shard; i < answers.size(); i += options.numShards)
+            mine.push_back(answers[i]);
+
+        answers.swap(mine);
+    }
+
+    return answers.empty() ? "No games to play" : "";
+}
+
+
+// Builds the tree for "strategy" into "root"
+// With --checkpoint, the exact search's states are saved as they're found, and with --resume,
+// the ones a killed run already saved are read back first, so the search only redoes what it lost
+// Returns an error message, or "" on success
+string buildTreeFor(const Dictionary &dict, SolverContext &ctx, Arena &arena, const Strategy &strategy,
+                    const Options &options, TreeNode *&root)
+{
+    Memo<Bound> memo;
+    Checkpoint checkpoint(options.checkpointInterval);
+    size_t numResumed = 0;
+
+    if (!options.checkpointFile.empty())
+    {
+        // Told apart from a sweep's checkpoint for the same strategy
+        uint64_t fingerprint = hashBytes("tree", 4, hashStrategy(dict, strategy));
+
+        string error = checkpoint.open(options.checkpointFile, fingerprint, options.resume,
+                                       [&](uint8_t type, const uint8_t *data, uint32_t size)
+        {
+            SavedState saved;
+
+            if (type != Checkpoint::STATE || size != sizeof(saved))
+                return;
+
+            memcpy(&saved, data, sizeof(saved));
+            memo.insert({ saved.a, saved.b, saved.size }, { saved.total, saved.guess, saved.exact != 0 });
+            numResumed++;
+        });
+
+        if (!error.empty())
+            return error;
+
+        if (numResumed > 0)
+            cerr << "Resuming from " << numResumed << " saved states" << endl;
+    }
+
+    root = buildTree(dict, ctx, arena, strategy, options.numThreads, &memo, checkpoint.isOpen() ? &checkpoint : nullptr);
+    return "";
+}
+
+
+// Plays "answers" and prints the games and statistics as "options" asks
+int runSweep(const Dictionary &dict, const Strategy &strategy, const Options &options, const vector<WordId> &answers)
+{
+    SolverContext ctx(dict);
+
+    // Only printed games need their guesses kept; the statistics are accumulated as games finish
+    bool keepGames = options.mode != QUIET;
+    vector<GameResult> games(keepGames ? answers.size() : 0);
+    Stats stats;
+
+    for (GameResult &game : games)
+        game.guesses.reserve(8);
+
+    // The exact optimum picks its own opener
+    WordId opener = strategy.firstGuess;
+
+    // A saved tree is played from its file instead, even an --optimal one
+    if (options.treeSweep && options.treeFile.empty())
+    {
+        // Games share their opening moves, so solve each state once and read every game off the tree
+        Arena arena;
+        TreeNode *root;
+        string error = buildTreeFor(dict, ctx, arena, strategy, options, root);
+
+        if (!error.empty())
+        {
+            cerr << error << endl;
+            return 1;
+        }
+
+        opener = root->guess;
+
+        vector<GameResult> treeGames(answers.size());
+        vector<int> gameOf(dict.text.size(), -1);
+
+        for (size_t i = 0; i < answers.size(); i++)
+            gameOf[answers[i]] = int(i);
+
+        vector<WordId> path;
+        readGames(*root, path, gameOf, treeGames);
+
+        for (const GameResult &game : treeGames)
+            stats.add(game.numGuesses, getResult(dict, opener, game.word));
+
+        if (keepGames)
+            games.swap(treeGames);
+    }
+
+    else
+    {
+        // Guesses come from a saved tree where it has them, so its strategy is part of the run's
+        MappedTree mapped;
+        const MappedTree *tree = nullptr;
+        uint64_t fingerprint = hashStrategy(dict, strategy);
+
+        if (!options.treeFile.empty())
+        {
+            string error = mapped.open(options.treeFile, dict);
+
+            if (error.empty())
+                error = strategyMismatch(mapped, dict, strategy, options.treeFile);
+
+            if (!error.empty())
+            {
+                cerr << error << endl;
+                return 1;
+            }
+
+            tree = &mapped;
+            fingerprint = hashBytes(&mapped.header.fingerprint, sizeof(mapped.header.fingerprint), fingerprint);
+
+            // Games open with the tree's guess, which an --optimal tree picks for itself
+            if (mapped.guess(mapped.root()) != NO_WORD)
+                opener = mapped.guess(mapped.root());
+        }
+
+        // Games finished by an earlier run are read back instead of replayed
+        vector<bool> done(answers.size());
+        Checkpoint checkpoint(options.checkpointInterval);
+
+        if (!options.checkpointFile.empty())
+        {
+            vector<int> gameOf(dict.text.size(), -1);
+
+            for (size_t i = 0; i < answers.size(); i++)
+                gameOf[answers[i]] = int(i);
+
+            string error = checkpoint.open(options.checkpointFile, fingerprint, options.resume,
+                                           [&](uint8_t type, const uint8_t *data, uint32_t size)
+            {
+                GameResult game;
+
+                if (type != Checkpoint::GAME || !decodeGame(data, size, game) || game.word >= dict.text.size())
+                    return;
+
+                int i = gameOf[game.word];
+
+                if (i < 0 || done[i])
+                    return;
+
+                done[i] = true;
+                stats.add(game.numGuesses, getResult(dict, opener, game.word));
+
+                if (keepGames)
+                    games[i] = game;
+            });
+
+            if (!error.empty())
+            {
+                cerr << error << endl;
+                return 1;
+            }
+        }
+
+        vector<size_t> pending;
+
+        for (size_t i = 0; i < answers.size(); i++)
+            if (!done[i])
+                pending.push_back(i);
+
+        // Every worker gets its own context, statistics and guess list
+        ThreadPool pool(options.numThreads);
+        vector<SolverContext> contexts(pool.size(), ctx);
+        vector<Stats> workerStats(pool.size());
+        vector<vector<WordId>> traces(pool.size());
+
+        pool.parallelFor(pending.size(), [&](int worker, size_t j)
+        {
+            size_t i = pending[j];
+            vector<WordId> &trace = traces[worker];
+            trace.clear();
+
+            int numGuesses = play(dict, contexts[worker], strategy, answers[i], &trace, tree);
+            workerStats[worker].add(numGuesses, getResult(dict, opener, answers[i]));
+
+            if (keepGames)
+            {
+                games[i].word = answers[i];
+                games[i].numGuesses = numGuesses;
+                games[i].guesses = trace;
+            }
+
+            if (checkpoint.isOpen())
+                checkpoint.append(Checkpoint::GAME, encodeGame(answers[i], numGuesses, trace));
+        });
+
+        for (const Stats &part : workerStats)
+            stats.merge(part);
+    }
+
+    Writer out(stdout);
+
+    if (options.mode == CSV)
+        out << "answer,guesses,count\n";
+
+    for (const GameResult &game : games)
+        printGame(out, dict, options.mode, game);
+
+    out.flush();
+
+    // Structured output keeps stdout machine-readable, so the summary goes to stderr
+    Writer summary(options.mode == CSV || options.mode == JSONL ? stderr : stdout);
+    stats.print(summary, options.maxAllowed, options.showBuckets ? dict.text[opener] : "");
+
+    if (!options.partialFile.empty())
+    {
+        Partial partial = {};
+        strncpy(partial.opener, dict.text[opener].c_str(), sizeof(partial.opener) - 1);
+        partial.stats = stats;
+
+        string error = writeShardFile(options.partialFile, PARTIAL_MAGIC, hashStrategy(dict, strategy),
+                                      options.shard, options.numShards, &partial.opener,
+                                      sizeof(partial) - offsetof(Partial, opener));
+
+        if (!error.empty())
+        {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+// Scores every allowed guess as the opener and prints them best first
+// Openers are simulated in parallel, sharing one memo of solved states: most states
+// past the first guess are reached from many openers
+int rankOpeners(const Dictionary &dict, const Strategy &strategy, const Options &options)
+{
+    bool simulate = options.rankOpeners == "full";
+    vector<OpenerScore> scores;
+    vector<uint32_t> pending;
+    vector<bool> done(dict.guesses.size());
+    Checkpoint checkpoint(options.checkpointInterval);
+
+    if (!options.checkpointFile.empty())
+    {
+        string error = checkpoint.open(options.checkpointFile, hashStrategy(dict, strategy) ^ simulate, options.resume,
+                                       [&](uint8_t type, const uint8_t *data, uint32_t size)
+        {
+            OpenerScore score;
+
+            if (type != Checkpoint::OPENER || size != sizeof(score))
+                return;
+
+            memcpy(&score, data, size);
+
+            if (score.order < done.size() && !done[score.order])
+            {
+                done[score.order] = true;
+                scores.push_back(score);
+            }
+        });
+
+        if (!error.empty())
+        {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+
+    for (size_t i = options.shard; i < dict.guesses.size(); i += options.numShards)
+        if (!done[i])
+            pending.push_back(uint32_t(i));
+
+    // Only this shard's openers count, even if the checkpoint has others
+    scores.erase(remove_if(scores.begin(), scores.end(), [&](const OpenerScore &score)
+    {
+        return int(score.order % options.numShards) != options.shard;
+    }), scores.end());
+
+    size_t numResumed = scores.size();
+    scores.resize(numResumed + pending.size());
+
+    ThreadPool pool(options.numThreads);
+    vector<SolverContext> contexts(pool.size(), SolverContext(dict));
+    vector<vector<WordId>> scratch(pool.size());
+    Memo<Solved> memo;
+
+    pool.parallelFor(pending.size(), [&](int worker, size_t i)
+    {
+        uint32_t order = pending[i];
+        OpenerScore &score = scores[numResumed + i];
+        score = scoreOpener(dict, contexts[worker], strategy.policy, memo, scratch[worker],
+                            dict.guesses[order], order, simulate);
+
+        if (checkpoint.isOpen())
+        {
+            const uint8_t *bytes = (const uint8_t *) &score;
+            checkpoint.append(Checkpoint::OPENER, vector<uint8_t>(bytes, bytes + sizeof(score)));
+        }
+    });
+
+    sort(scores.begin(), scores.end());
+
+    Writer out(stdout);
+    printRanking(out, scores, options.mode, options.top);
+
+    if (!options.partialFile.empty())
+    {
+        string error = writeShardFile(options.partialFile, RANKING_MAGIC, hashStrategy(dict, strategy) ^ simulate,
+                                      options.shard, options.numShards, scores.data(), scores.size() * sizeof(OpenerScore));
+
+        if (!error.empty())
+        {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+// Plays "answers" without printing anything
+vector<GameResult> playAll(const Dictionary &dict, const Strategy &strategy, const vector<WordId> &answers,
+                           int numThreads, bool treeSweep)
+{
+    vector<GameResult> games(answers.size());
+    SolverContext ctx(dict);
+
+    if (treeSweep)
+    {
+        Arena arena;
+        TreeNode *root = buildTree(dict, ctx, arena, strategy, numThreads);
+        vector<int> gameOf(dict.text.size(), -1);
+
+        for (size_t i = 0; i < answers.size(); i++)
+            gameOf[answers[i]] = int(i);
+
+        vector<WordId> path;
+        readGames(*root, path, gameOf, games);
+    }
+
+    else
+    {
+        ThreadPool pool(numThreads);
+        vector<SolverContext> contexts(pool.size(), ctx);
+
+        pool.parallelFor(answers.size(), [&](int worker, size_t i)
+        {
+            games[i].word = answers[i];
+            games[i].numGuesses = play(dict, contexts[worker], strategy, answers[i], &games[i].guesses);
+        });
+    }
+
+    return games;
+}
+
+
+// Replays the sweep with 1, 2 and N threads, both kernels, and with and without --tree (building the tree
+// on that many threads), and fails unless every game (and so every state's chosen guess) and the statistics match exactly
+// Nothing in the engine should vary: scores and statistics are integers, ties are broken by
+// guess list order, and per-worker results are merged by index or by exact integer sums
+int checkDeterminism(const Dictionary &dict, const Strategy &strategy, const vector<WordId> &answers, int numThreads)
+{
+    Dictionary scalarDict = dict;
+    scalarDict.matrix.clear();
+
+    Dictionary simdDict = dict;
+
+    if (simdDict.matrix.empty())
+        buildMatrix(simdDict);
+
+    vector<GameResult> expected;
+    Stats expectedStats;
+    int failures = 0;
+
+    for (bool treeSweep : { false, true })
+    {
+        // The optimal tree is meant to differ from play, so its rows are checked against each other
+        if (treeSweep && strategy.optimal)
+            expected.clear();
+
+        for (int threads : { 1, 2, max(numThreads, 4) })
+        {
+            for (bool simd : { true, false })
+            {
+                useSimd = simd;
+                vector<GameResult> games = playAll(simd ? simdDict : scalarDict, strategy, answers, threads, treeSweep);
+                Stats stats;
+
+                for (const GameResult &game : games)
+                    stats.add(game.numGuesses, getResult(dict, strategy.firstGuess, game.word));
+
+                cout << (treeSweep ? "tree" : "play") << ", " << threads << " thread(s), "
+                     << (simd ? "simd" : "scalar") << ": ";
+
+                if (expected.empty())
+                {
+                    expected = move(games);
+                    expectedStats = stats;
+                    cout << "reference" << endl;
+                    continue;
+                }
+
+                size_t mismatch = 0;
+
+                while (mismatch < games.size() && games[mismatch].numGuesses == expected[mismatch].numGuesses &&
+                       games[mismatch].guesses == expected[mismatch].guesses)
+                    mismatch++;
+
+                if (mismatch < games.size())
+                {
+                    cout << "differs on " << dict.text[answers[mismatch]] << endl;
+                    failures++;
+                }
+
+                else if (memcmp(&stats, &expectedStats, sizeof(stats)) != 0)
+                {
+                    cout << "statistics differ" << endl;
+                    failures++;
+                }
+
+                else
+                    cout << "identical" << endl;
+            }
+        }
+    }
+
+    useSimd = true;
+    return failures == 0 ? 0 : 1;
+}
+
+
+// Writes "node" and its subtree as one nested JSON object
+// Only the path from the root is held at any time, however big the tree is
+void exportJson(Writer &out, const MappedTree &tree, const MappedTree::Node &node)
+{
+    out.format("{\"guess\":\"%s\",\"candidates\":%u,\"total\":%u,\"average\":%.4f", tree.text(node).c_str(),
+               node.numCandidates, node.totalGuesses, double(node.totalGuesses) / node.numCandidates);
+
+    if (node.numChildren > 0)
+    {
+        out << ",\"children\":{";
+
+        for (uint32_t i = node.firstChild; i < node.firstChild + node.numChildren; i++)
+        {
+            out << (i > node.firstChild ? ",\"" : "\"") << patternString(tree.patternTo(i)) << "\":";
+            exportJson(out, tree, tree.node(i));
+        }
+
+        out << '}';
+    }
+
+    out << '}';
+}
+
+
+// Writes the tree for Graphviz, one line per node and per edge, straight from the file
+void exportDot(Writer &out, const MappedTree &tree)
+{
+    out << "digraph wordlebot {\n  node [shape=box, fontname=\"monospace\"];\n";
+
+    for (size_t i = 0; i < tree.numNodes; i++)
+    {
+        const MappedTree::Node &node = tree.node(i);
+        out.format("  n%zu [label=\"%s\\n%u left, %.3f avg\"];\n", i, tree.text(node).c_str(), node.numCandidates,
+                   double(node.totalGuesses) / node.numCandidates);
+
+        for (uint32_t j = node.firstChild; j < node.firstChild + node.numChildren; j++)
+            out << "  n" << i << " -> n" << size_t(j) << " [label=\"" << patternString(tree.patternTo(j)) << "\"];\n";
+    }
+
+    out << "}\n";
+}
+
+
+// Streams the tree file at "path" to stdout as "format" (json or dot)
+int exportTree(const Dictionary &dict, const string &path, const string &format)
+{
+    MappedTree tree;
+    string error = tree.open(path, dict);
+
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    // Both formats follow every node's children, so a damaged file is turned away before anything is written
+    for (size_t i = 0; i < tree.numNodes; i++)
+    {
+        if (!tree.childrenInPlace(tree.node(i)))
+        {
+            cerr << path << ": node " << i << "'s children are out of place" << endl;
+            return 1;
+        }
+    }
+
+    Writer out(stdout);
+
+    if (format == "json")
+    {
+        exportJson(out, tree, tree.node(0));
+        out << '\n';
+    }
+
+    else
+        exportDot(out, tree);
+
+    return 0;
+}
+
+
+// Checks the tree file at "path" against the dictionary and prints every problem and the answers' statistics
+int verifyTree(const Dictionary &dict, const Strategy &strategy, const string &path, int numThreads, int maxAllowed)
+{
+    auto start = chrono::steady_clock::now();
+    MappedTree tree;
+    string error = tree.open(path, dict);
+
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    // The checks hold for a tree of any strategy, so a mismatch is only worth a warning
+    string mismatch = strategyMismatch(tree, dict, strategy, path);
+
+    if (!mismatch.empty())
+        cerr << "Warning: " << mismatch << endl;
+
+    Stats stats;
+    vector<string> issues = checkTree(dict, tree, numThreads, stats);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    Writer out(stdout);
+
+    for (const string &issue : issues)
+        out << issue << "\n";
+
+    out.format("%zu nodes and %zu answers checked in %.3f s: %zu problem(s)\n", tree.numNodes, dict.numAnswers,
+               seconds, issues.size());
+    stats.print(out, maxAllowed);
+    return issues.empty() ? 0 : 1;
+}
+
+
+// Prints what "session" should do next
+void printSuggestion(Writer &out, const Engine &engine, SolverContext &ctx, const Session &session)
+{
+    size_t left = numLeft(session);
+    WordId guess = suggest(engine, ctx, session);
+
+    if (left == 0)
+        out << (contradictory(session.k) ? "That feedback contradicts itself or the feedback before it"
+                                         : "No word in the answer list fits that feedback") << "; \"new\" starts over\n";
+
+    else if (left == 1)
+        out << "The word is " << engine.dict.text[guess] << "\n";
+
+    else
+        out << "Try " << engine.dict.text[guess] << " (" << left << " words left)\n";
+
+    out.flush();
+}
+
+
+// Solves a real game: reads each guess and its feedback from stdin, a line at a time, and replies with the next guess
+// Everything is solved before the first line is read, so replies on the tree's path are lookups
+int runInteractive(const Dictionary &dict, const Strategy &strategy, const Options &options)
+{
+    Engine engine(dict, strategy, options.maxStates);
+    string error = engine.open(options.treeFile, options.numThreads);
+
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    SolverContext ctx(dict);
+    Session session;
+    startSession(engine, session);
+
+    Writer out(stdout);
+    out << "Enter each guess and its feedback (0 or b gray, 1 or y yellow, 2 or g green), e.g. RAISE 00102\n"
+        << "\"new\" starts a new game\n";
+    printSuggestion(out, engine, ctx, session);
+
+    string line;
+
+    while (getline(cin, line))
+    {
+        char word[16], feedback[16];
+        int numFields = sscanf(line.c_str(), "%15s %15s", word, feedback);
+        array<uint8_t, 5> letters;
+        Pattern result;
+
+        if (numFields <= 0)
+            continue;
+
+        if (numFields == 1 && strcasecmp(word, "new") == 0)
+            startSession(engine, session);
+
+        else if (numFields == 2 && parseLetters(word, letters) && parsePattern(feedback, result))
+            addGuess(engine, session, letters, result);
+
+        else
+        {
+            out << "Expected a 5-letter guess and its feedback, e.g. RAISE 00102\n";
+            out.flush();
+            continue;
+        }
+
+        printSuggestion(out, engine, ctx, session);
+    }
+
+    return 0;
+}
+
+
+// Games in progress on the server, shared by every connection, so a client can pick a game up on any of them
+// Each game has a lock of its own, and the table is only locked to find, add or remove one
+// Clients that go away without ENDing their games would fill it, so games unused for "idleTimeout" seconds
+// are dropped, and no more than "maxGames" are kept at once
+class SessionTable
+{
+public:
+    struct Entry
+    {
+        mutex m;
+        Session session;
+        chrono::steady_clock::time_point lastUsed;   // guarded by the table's lock
+    };
+
+    SessionTable(size_t maxGames, double idleTimeout) : maxGames(maxGames), idleTimeout(idleTimeout) {}
+
+    // Starts a game and returns its id, or 0 if the table is full even after dropping idle games
+    uint64_t add(const Engine &engine)
+    {
+        shared_ptr<Entry> entry = make_shared<Entry>();
+        startSession(engine, entry->session);
+
+        lock_guard<mutex> lock(m);
+
+        if (entries.size() >= maxGames)
+            dropIdle();
+
+        if (entries.size() >= maxGames)
+            return 0;
+
+        uint64_t id = nextId++;
+        entry->lastUsed = chrono::steady_clock::now();
+        entries.emplace(id, entry);
+        return id;
+    }
+
+    // The game "id", or nullptr if there's no such game
+    shared_ptr<Entry> find(uint64_t id)
+    {
+        lock_guard<mutex> lock(m);
+        auto it = entries.find(id);
+
+        if (it == entries.end())
+            return nullptr;
+
+        it->second->lastUsed = chrono::steady_clock::now();
+        return it->second;
+    }
+
+    // Returns false if there's no such game
+    bool remove(uint64_t id)
+    {
+        lock_guard<mutex> lock(m);
+        return entries.erase(id) > 0;
+    }
+
+    // Drops every game unused for longer than the timeout; a request already working on one still finishes it
+    void expire()
+    {
+        lock_guard<mutex> lock(m);
+        dropIdle();
+    }
+
+private:
+    mutex m;
+    uint64_t nextId = 1;
+    unordered_map<uint64_t, shared_ptr<Entry>> entries;
+    size_t maxGames;
+    double idleTimeout;
+
+    void dropIdle()
+    {
+        auto now = chrono::steady_clock::now();
+
+        for (auto it = entries.begin(); it != entries.end(); )
+        {
+            if (chrono::duration<double>(now - it->second->lastUsed).count() > idleTimeout)
+                it = entries.erase(it);
+
+            else
+                ++it;
+        }
+    }
+};
+
+
+// Answers one request of the server's line protocol, appending the reply to "out":
+//   NEW                           -> OK <id>
+//   GUESS <id> <word> <feedback>  -> OK <words left>
+//   HINT <id>                     -> OK <next guess> <words left>, with "-" for the guess if no word fits
+//   END <id>                      -> OK
+// Anything else gets ERR and a reason
+void serveRequest(const Engine &engine, SessionTable &sessions, SolverContext &ctx, const char *line, string &out)
+{
+    char command[16], word[16], feedback[16];
+    unsigned long long id = 0;
+    int numFields = sscanf(line, "%15s %llu %15s %15s", command, &id, word, feedback);
+    char reply[64];
+
+    if (numFields == 1 && strcasecmp(command, "NEW") == 0)
+    {
+        uint64_t added = sessions.add(engine);
+
+        if (added == 0)
+        {
+            out += "ERR too many games; END some first\n";
+            return;
+        }
+
+        snprintf(reply, sizeof(reply), "OK %llu\n", (unsigned long long) added);
+        out += reply;
+        return;
+    }
+
+    bool guess = numFields == 4 && strcasecmp(command, "GUESS") == 0;
+    bool hint = numFields == 2 && strcasecmp(command, "HINT") == 0;
+    bool end = numFields == 2 && strcasecmp(command, "END") == 0;
+    array<uint8_t, 5> letters;
+    Pattern result;
+
+    if (!guess && !hint && !end)
+    {
+        out += "ERR expected NEW, GUESS <id> <word> <feedback>, HINT <id> or END <id>\n";
+        return;
+    }
+
+    if (guess && !(parseLetters(word, letters) && parsePattern(feedback, result)))
+    {
+        out += "ERR expected a 5-letter guess and its feedback, e.g. RAISE 00102\n";
+        return;
+    }
+
+    if (end)
+    {
+        out += sessions.remove(id) ? "OK\n" : "ERR no such game\n";
+        return;
+    }
+
+    shared_ptr<SessionTable::Entry> entry = sessions.find(id);
+
+    if (!entry)
+    {
+        out += "ERR no such game\n";
+        return;
+    }
+
+    lock_guard<mutex> lock(entry->m);
+    Session &session = entry->session;
+
+    if (guess)
+    {
+        addGuess(engine, session, letters, result);
+        snprintf(reply, sizeof(reply), "OK %zu\n", numLeft(session));
+    }
+
+    else
+    {
+        WordId next = suggest(engine, ctx, session);
+        snprintf(reply, sizeof(reply), "OK %s %zu\n", next == NO_WORD ? "-" : engine.dict.text[next].c_str(), numLeft(session));
+    }
+
+    out += reply;
+}
+
+
+// Serves one client until it hangs up, or stays silent past the socket's receive timeout
+// Every complete line read is answered, and the replies go back in one write, so pipelined requests are cheap
+void serveConnection(const Engine &engine, SessionTable &sessions, int fd)
+{
+    const size_t MAX_LINE = 256;
+    SolverContext ctx(engine.dict);
+    string in, out;
+    char buffer[1 << 16];
+    ssize_t size;
+
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        in.append(buffer, size);
+        size_t start = 0, end;
+
+        while ((end = in.find('\n', start)) != string::npos)
+        {
+            in[end] = '\0';
+
+            if (end > start && in[end - 1] == '\r')
+                in[end - 1] = '\0';
+
+            serveRequest(engine, sessions, ctx, &in[start], out);
+            start = end + 1;
+        }
+
+        in.erase(0, start);
+        bool tooLong = in.size() > MAX_LINE;
+
+        if (tooLong)
+            out += "ERR line too long\n";
+
+        // A client that has gone away just ends the connection; MSG_NOSIGNAL keeps it from killing the server
+        for (size_t sent = 0; sent < out.size(); )
+        {
+            ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+
+            if (n < 0 && errno == EINTR)
+                continue;
+
+            if (n <= 0)
+            {
+                tooLong = true;
+                break;
+            }
+
+            sent += n;
+        }
+
+        out.clear();
+
+        if (tooLong)
+            break;
+    }
+
+    close(fd);
+}
+
+
+// Serves games over a UNIX domain socket at "path" until killed, one thread per connection
+// Every connection shares one engine, so the tree is built once and states solved off it are solved once
+// Connections past options.maxConnections are turned away, and idle games and clients are dropped
+int runServer(const Dictionary &dict, const Strategy &strategy, const Options &options)
+{
+    const string &path = options.socketPath;
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "Socket path is too long: " << path << endl;
+        return 1;
+    }
+
+    strcpy(address.sun_path, path.c_str());
+
+    Engine engine(dict, strategy, options.maxStates);
+    string error = engine.open(options.treeFile, options.numThreads);
+
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    // A socket left behind by an earlier server would make bind fail, but nothing else gets removed
+    struct stat info;
+
+    if (stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0 || bind(listener, (sockaddr *) &address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0)
+    {
+        cerr << "Couldn't listen on " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    cout << "Listening on " << path << endl;
+    SessionTable sessions(options.maxGames, options.idleTimeout);
+    mutex m;
+    int numConnections = 0;
+
+    // Games left behind are dropped even while nobody starts new ones
+    thread([&sessions, &options]()
+    {
+        while (true)
+        {
+            this_thread::sleep_for(chrono::duration<double>(min(options.idleTimeout / 2, 60.0)));
+            sessions.expire();
+        }
+    }).detach();
+
+    // A client that stays silent this long is hung up on, so it can't hold a connection forever
+    timeval timeout;
+    timeout.tv_sec = time_t(options.idleTimeout);
+    timeout.tv_usec = suseconds_t((options.idleTimeout - double(timeout.tv_sec)) * 1e6);
+
+    while (true)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+
+        // Out of descriptors or an aborted connection: wait for things to clear up rather than quit
+        if (fd < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+                this_thread::sleep_for(chrono::milliseconds(10));
+
+            continue;
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+
+            if (numConnections >= options.maxConnections)
+            {
+                const char busy[] = "ERR too many connections\n";
+                send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(fd);
+                continue;
+            }
+
+            numConnections++;
+        }
+
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        thread([&engine, &sessions, &m, &numConnections, fd]()
+        {
+            serveConnection(engine, sessions, fd);
+            lock_guard<mutex> lock(m);
+            numConnections--;
+        }).detach();
+    }
+}
+
+
+// One guess of a history and the feedback it got
+struct Step
+{
+    array<uint8_t, 5> letters;
+    Pattern result;
+};
+
+
+// Reads a history like "RAISE 00102 CLOUT 10000": each guess followed by its feedback, any number of them
+// Returns false if "line" isn't one
+bool parseHistory(const string &line, vector<Step> &steps)
+{
+    steps.clear();
+    char word[16], feedback[16];
+    int used;
+
+    for (const char *text = line.c_str(); sscanf(text, "%15s%n", word, &used) == 1; )
+    {
+        text += used;
+
+        if (sscanf(text, "%15s%n", feedback, &used) != 1)
+            return false;
+
+        text += used;
+        Step step;
+
+        if (!parseLetters(word, step.letters) || !parsePattern(feedback, step.result))
+            return false;
+
+        steps.push_back(step);
+    }
+
+    return true;
+}
+
+
+// Answers a file of histories, one per line, with the next guess for each ("-" for the file is stdin)
+// The histories are merged into a tree of their prefixes, so a prefix many share is only filtered once,
+// each from its parent's candidates; states that more than one history reaches are solved once,
+// and all of them are solved in parallel
+int runBatch(const Dictionary &dict, const Strategy &strategy, const Options &options)
+{
+    auto start = chrono::steady_clock::now();
+    ifstream file;
+
+    if (options.batchFile != "-")
+    {
+        file.open(options.batchFile);
+
+        if (!file)
+        {
+            cerr << "Couldn't read " << options.batchFile << endl;
+            return 1;
+        }
+    }
+
+    istream &in = options.batchFile == "-" ? cin : file;
+    Engine engine(dict, strategy, options.maxStates);
+    string error = engine.open(options.treeFile, options.numThreads);
+
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    // Every distinct prefix, found by its parent and the step from it:
+    // the step's guess as a base 26 number, times the number of feedbacks, plus the feedback
+    vector<Session> states(1);
+    unordered_map<uint64_t, uint32_t> childOf;
+    startSession(engine, states[0]);
+
+    vector<int64_t> stateOf;   // for each line, its state, or -1 if it isn't a history
+    vector<char> asked(1, false);
+    vector<Step> steps;
+    string line;
+
+    while (getline(in, line))
+    {
+        if (!parseHistory(line, steps))
+        {
+            stateOf.push_back(-1);
+            continue;
+        }
+
+        uint32_t state = 0;
+
+        for (const Step &step : steps)
+        {
+            uint64_t code = 0;
+
+            for (uint8_t letter : step.letters)
+                code = code * 26 + letter;
+
+            auto added = childOf.emplace(uint64_t(state) << 32 | (code * NUM_PATTERNS + step.result), uint32_t(states.size()));
+
+            if (added.second)
+            {
+                Session next = states[state];
+                addGuess(engine, next, step.letters, step.result);
+                states.push_back(move(next));
+                asked.push_back(false);
+            }
+
+            state = added.first->second;
+        }
+
+        stateOf.push_back(state);
+        asked[state] = true;
+    }
+
+    // States on the tree are lookups; the rest are solved once per distinct state
+    unordered_map<SetKey, uint32_t, SetKeyHash> firstWith;
+    vector<uint32_t> sameAs(states.size());
+    vector<uint32_t> unsolved;
+
+    for (uint32_t i = 0; i < states.size(); i++)
+    {
+        sameAs[i] = i;
+
+        if (!asked[i] || states[i].node || states[i].candidates.size() <= 1)
+            continue;
+
+        auto added = firstWith.emplace(sessionKey(engine, states[i]), i);
+        sameAs[i] = added.first->second;
+
+        if (added.second)
+            unsolved.push_back(i);
+    }
+
+    ThreadPool pool(options.numThreads);
+    vector<SolverContext> contexts;
+    contexts.reserve(pool.size());
+
+    for (int i = 0; i < pool.size(); i++)
+        contexts.emplace_back(dict);
+
+    vector<WordId> guessOf(states.size(), NO_WORD);
+
+    pool.parallelFor(unsolved.size(), [&](int worker, size_t i)
+    {
+        guessOf[unsolved[i]] = suggest(engine, contexts[worker], states[unsolved[i]]);
+    });
+
+    for (uint32_t i = 0; i < states.size(); i++)
+        if (asked[i] && sameAs[i] == i && guessOf[i] == NO_WORD)
+            guessOf[i] = suggest(engine, contexts[0], states[i]);
+
+    Writer out(stdout);
+
+    if (options.mode == CSV)
+        out << "line,guess,left\n";
+
+    for (size_t i = 0; i < stateOf.size(); i++)
+    {
+        if (stateOf[i] < 0)
+        {
+            if (options.mode == CSV)
+                out << i + 1 << ",,\n";
+
+            else if (options.mode == JSONL)
+                out << "{\"line\":" << i + 1 << ",\"error\":\"not a history\"}\n";
+
+            else
+                out << "ERR expected guesses and their feedback, e.g. RAISE 00102 CLOUT 10000\n";
+
+            continue;
+        }
+
+        const Session &state = states[stateOf[i]];
+        WordId guess = guessOf[sameAs[stateOf[i]]];
+        const char *text = guess == NO_WORD ? "-" : dict.text[guess].c_str();
+
+        if (options.mode == CSV)
+            out.format("%zu,%s,%zu\n", i + 1, text, numLeft(state));
+
+        else if (options.mode == JSONL)
+            out.format("{\"line\":%zu,\"guess\":\"%s\",\"left\":%zu}\n", i + 1, text, numLeft(state));
+
+        else
+            out.format("%s %zu\n", text, numLeft(state));
+    }
+
+    out.flush();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%zu histories, %zu distinct prefixes, %zu states solved live in %.3f s\n",
+            stateOf.size(), states.size() - 1, unsolved.size(), seconds);
+    return 0;
+}
+
+
+// "wordlebot merge [--max-guesses N] [--buckets] [--top N] [--csv | --jsonl] FILE..."
+// Combines the partial results of every shard of one sweep or ranking into the final results
+int mergeMain(int argc, char **argv)
+{
+    int maxAllowed = 6;
+    bool showBuckets = false;
+    size_t top = 0;
+    OutputMode mode = VERBOSE;
+    vector<string> paths;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--max-guesses") == 0 && i + 1 < argc)
+            maxAllowed = atoi(argv[++i]);
+
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            top = max(0, atoi(argv[++i]));
+
+        else if (strcmp(argv[i], "--buckets") == 0)
+            showBuckets = true;
+
+        else if (strcmp(argv[i], "--csv") == 0)
+            mode = CSV;
+
+        else if (strcmp(argv[i], "--jsonl") == 0)
+            mode = JSONL;
+
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        cerr << "Usage: wordlebot merge [--max-guesses N] [--buckets] [--top N] [--csv | --jsonl] FILE..." << endl;
+        return 1;
+    }
+
+    Stats stats;
+    string opener;
+    vector<OpenerScore> scores;
+    ShardHeader first = {};
+    vector<bool> seen;
+
+    for (const string &path : paths)
+    {
+        ShardHeader header;
+        vector<uint8_t> data;
+        FILE *file = fopen(path.c_str(), "rb");
+        bool ok = file && fread(&header, sizeof(header), 1, file) == 1;
+
+        if (ok)
+        {
+            uint8_t buffer[1 << 16];
+
+            for (size_t size; (size = fread(buffer, 1, sizeof(buffer), file)) > 0; )
+                data.insert(data.end(), buffer, buffer + size);
+        }
+
+        if (file)
+            fclose(file);
+
+        bool isPartial = ok && memcmp(header.magic, PARTIAL_MAGIC, sizeof(header.magic)) == 0;
+        bool isRanking = ok && memcmp(header.magic, RANKING_MAGIC, sizeof(header.magic)) == 0;
+
+        if ((!isPartial || data.size() != sizeof(Partial) - offsetof(Partial, opener)) &&
+            (!isRanking || data.size() % sizeof(OpenerScore) != 0))
+        {
+            cerr << "Couldn't read " << path << endl;
+            return 1;
+        }
+
+        if (seen.empty())
+        {
+            first = header;
+            seen.resize(header.numShards);
+        }
+
+        if (memcmp(header.magic, first.magic, sizeof(header.magic)) != 0 || header.fingerprint != first.fingerprint ||
+            header.numShards != first.numShards || header.shard >= header.numShards)
+        {
+            cerr << path << " belongs to a different run" << endl;
+            return 1;
+        }
+
+        if (seen[header.shard])
+        {
+            cerr << path << ": shard " << header.shard << " was already merged" << endl;
+            return 1;
+        }
+
+        seen[header.shard] = true;
+
+        if (isPartial)
+        {
+            Partial partial;
+            memcpy(&partial.opener, data.data(), data.size());
+            opener = partial.opener;
+            stats.merge(partial.stats);
+        }
+
+        else
+        {
+            size_t count = data.size() / sizeof(OpenerScore);
+            scores.resize(scores.size() + count);
+            memcpy(&scores[scores.size() - count], data.data(), data.size());
+        }
+    }
+
+    for (size_t shard = 0; shard < seen.size(); shard++)
+        if (!seen[shard])
+            cerr << "Warning: shard " << shard << "/" << seen.size() << " is missing" << endl;
+
+    Writer out(stdout);
+
+    if (memcmp(first.magic, PARTIAL_MAGIC, sizeof(first.magic)) == 0)
+        stats.print(out, maxAllowed, showBuckets ? opener : "");
+
+    else
+    {
+        sort(scores.begin(), scores.end());
+        printRanking(out, scores, mode, top);
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "merge") == 0)
+        return mergeMain(argc, argv);
+
+    Options options;
+
+    if (!parseOptions(argc, argv, options))
+    {
+        cerr << USAGE;
+        return 1;
+    }
+
+    vector<string> answerList = loadWords(options.answersFile);
+    vector<string> guessList;
+
+    if (!options.guessesFile.empty())
+        guessList = loadWords(options.guessesFile);
+
+    if (answerList.size() == 0 || (!options.guessesFile.empty() && guessList.size() == 0))
+    {
+        cout << "Couldn't read file!" << endl;
+        return 0;
+    }
+
+    if (answerList.size() + guessList.size() > 65535)
+    {
+        cerr << "Too many words: ids are 16 bits" << endl;
+        return 1;
+    }
+
+    Dictionary dict = makeDictionary(answerList, guessList);
+    useSimd = options.kernel == "simd";
+
+    if (useSimd)
+        buildMatrix(dict);
+
+    Strategy strategy;
+    strategy.policy = options.policy;
+    strategy.optimal = options.optimal;
+    strategy.hardMode = options.hardMode;
+
+    // Precomputed optimal first guess to save time, as long as it's one of this dictionary's guesses
+    int firstGuess = findWord(dict, options.opener.empty() ? "RAISE" : options.opener);
+
+    if (firstGuess >= 0 && find(dict.guesses.begin(), dict.guesses.end(), WordId(firstGuess)) == dict.guesses.end())
+        firstGuess = -1;
+
+    if (firstGuess < 0 && !options.opener.empty() && options.opener != "auto")
+    {
+        cerr << options.opener << " isn't in the guess list" << endl;
+        return 1;
+    }
+
+    if (firstGuess < 0)
+    {
+        SolverContext ctx(dict);
+        vector<WordId> all(dict.numAnswers);
+        iota(all.begin(), all.end(), 0);
+        firstGuess = getGuess(dict, ctx, strategy.policy, dict.guesses, all);
+    }
+
+    strategy.firstGuess = WordId(firstGuess);
+
+    if (!options.rankOpeners.empty())
+        return rankOpeners(dict, strategy, options);
+
+    if (!options.buildTreeFile.empty())
+    {
+        SolverContext ctx(dict);
+        Arena arena;
+        TreeNode *root;
+
+        if (options.repairTreeFile.empty())
+        {
+            string error = buildTreeFor(dict, ctx, arena, strategy, options, root);
+
+            if (!error.empty())
+            {
+                cerr << error << endl;
+                return 1;
+            }
+        }
+
+        else
+        {
+            auto start = chrono::steady_clock::now();
+            MappedTree old;
+            string error = old.open(options.repairTreeFile, dict);
+
+            if (!error.empty())
+            {
+                cerr << error << endl;
+                return 1;
+            }
+
+            RepairCounts counts;
+            root = repairTree(dict, ctx, arena, strategy, old, counts);
+
+            // The old answer list is the start of the old word table
+            size_t numOld = old.node(0).numCandidates, numKept = 0;
+
+            for (size_t i = 0; i < numOld; i++)
+            {
+                int id = findWord(dict, old.word(i));
+                numKept += id >= 0 && size_t(id) < dict.numAnswers;
+            }
+
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            Writer out(stdout);
+            out.format("%zu answers added, %zu removed: kept %zu guesses, solved %zu states from scratch (%zu nodes) in %.3f s\n",
+                       dict.numAnswers - numKept, numOld - numKept, counts.kept, counts.solved, counts.rebuilt, seconds);
+        }
+
+        string error = saveTree(options.buildTreeFile, dict, *root, hashStrategy(dict, strategy));
+
+        if (!error.empty())
+        {
+            cerr << error << endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (!options.exportFormat.empty())
+    {
+        if (options.treeFile.empty())
+        {
+            cerr << "--export needs a --tree-file to export" << endl;
+            return 1;
+        }
+
+        return exportTree(dict, options.treeFile, options.exportFormat);
+    }
+
+    if (!options.verifyTreeFile.empty())
+        return verifyTree(dict, strategy, options.verifyTreeFile, options.numThreads, options.maxAllowed);
+
+    if (options.interactive)
+        return runInteractive(dict, strategy, options);
+
+    if (!options.socketPath.empty())
+        return runServer(dict, strategy, options);
+
+    if (!options.batchFile.empty())
+        return runBatch(dict, strategy, options);
+
+    vector<WordId> answers;
+    string error = selectAnswers(dict, options, answers);
+
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    if (options.checkAllocs)
+    {
+        SolverContext ctx(dict);
+        return checkAllocations(dict, ctx, strategy, answers);
+    }
 
-    cout.precision(3);
-    sort(results.begin(), results.end());
+    if (options.checkDeterminism)
+        return checkDeterminism(dict, strategy, answers, options.numThreads);
 
-    cout << "Here are the results! " << endl;
-    cout << "Minimum # of Guesses: " << results[0] << endl;
-    cout << "Median # of Guesses: "  << results[n/2] << endl;
-    cout << "Maximum # of Guesses: " << results[n-1] << endl;
-    cout << "Average # of Guesses: " << sum / float(n) << endl;
+    return runSweep(dict, strategy, options, answers);
 }